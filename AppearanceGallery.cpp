@@ -0,0 +1,166 @@
+// AppearanceGallery.cpp
+// Appearance descriptors and the lost-track gallery, see AppearanceGallery.h
+//
+
+#include "AppearanceGallery.h"
+#include "SwcCommon.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const int kHalfBins = kAppearanceBins / 2; // 8 hue x 3 saturation + 8 grey
+
+// Eight independent lanes: no reordering of a single sum, so this vectorizes without fast-math
+static float dot(const float* a, const float* b)
+{
+    float acc[8] = {};
+    for (int i = 0; i < kAppearanceBins; i += 8)
+    {
+        for (int j = 0; j < 8; ++j) acc[j] += a[i + j] * b[i + j];
+    }
+    return ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+}
+
+static void normalise(float* v)
+{
+    float n = sqrt(dot(v, v));
+    if (n <= 0.0f) return;
+    for (int i = 0; i < kAppearanceBins; ++i) v[i] /= n;
+}
+
+bool computeAppearance(const cv::Mat& frame, const cv::Rect& box, AppearanceDescriptor& out)
+{
+    // the middle 60% of the width and 10..90% of the height: less background, no head or feet
+    cv::Rect core(box.x + box.width / 5, box.y + box.height / 10, box.width * 3 / 5, box.height * 4 / 5);
+    core &= cv::Rect(0, 0, frame.cols, frame.rows);
+    if (core.width < 4 || core.height < 8 || frame.type() != CV_8UC3) return false;
+
+    // 16x32 samples are plenty for a colour histogram and keep this in the tens of microseconds
+    cv::Mat small, hsv;
+    cv::resize(frame(core), small, cv::Size(16, 32), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(small, hsv, cv::COLOR_BGR2HSV);
+
+    float hist[kAppearanceBins] = {};
+    for (int y = 0; y < hsv.rows; ++y)
+    {
+        float* h = hist + (y < hsv.rows / 2 ? 0 : kHalfBins);
+        const uchar* p = hsv.ptr<uchar>(y);
+        for (int x = 0; x < hsv.cols; ++x, p += 3)
+        {
+            // dark or washed out pixels have no reliable hue: grey level bins
+            if (p[1] < 40 || p[2] < 40) h[24 + p[2] / 32] += 1.0f;
+            else h[(p[0] * 8 / 180) * 3 + min(2, (p[1] - 40) / 72)] += 1.0f;
+        }
+    }
+    for (int i = 0; i < kAppearanceBins; ++i) out.v[i] = sqrt(hist[i]);
+    normalise(out.v);
+    out.samples = 1;
+    return true;
+}
+
+void blendAppearance(AppearanceDescriptor& acc, const AppearanceDescriptor& sample, float alpha)
+{
+    if (sample.samples == 0) return;
+    if (acc.samples == 0)
+    {
+        acc = sample;
+        return;
+    }
+    for (int i = 0; i < kAppearanceBins; ++i) acc.v[i] += alpha * (sample.v[i] - acc.v[i]);
+    normalise(acc.v);
+    ++acc.samples;
+}
+
+float appearanceSimilarity(const AppearanceDescriptor& a, const AppearanceDescriptor& b)
+{
+    return dot(a.v, b.v);
+}
+
+AppearanceGallery::AppearanceGallery(size_t capacity, double maxAgeMs)
+{
+    configure(capacity, maxAgeMs);
+}
+
+void AppearanceGallery::configure(size_t capacity, double maxAgeMs)
+{
+    m_maxAgeMs = maxAgeMs;
+    m_rows.assign(capacity * kAppearanceBins, 0.0f);
+    m_ids.assign(capacity, 0);
+    m_lostTs.assign(capacity, 0.0);
+    m_usedTs.assign(capacity, 0.0);
+    m_st = GalleryStats();
+    m_querySum = 0.0;
+}
+
+size_t AppearanceGallery::size() const
+{
+    return m_ids.size() - count(m_ids.begin(), m_ids.end(), 0);
+}
+
+void AppearanceGallery::add(int id, const AppearanceDescriptor& d, double tsMs)
+{
+    if (m_ids.empty() || d.samples == 0) return;
+    // same id, else a free row, else the least recently used one
+    size_t row = 0;
+    auto same = find(m_ids.begin(), m_ids.end(), id);
+    auto free = find(m_ids.begin(), m_ids.end(), 0);
+    if (same != m_ids.end()) row = same - m_ids.begin();
+    else if (free != m_ids.end()) row = free - m_ids.begin();
+    else
+    {
+        row = min_element(m_usedTs.begin(), m_usedTs.end()) - m_usedTs.begin();
+        ++m_st.evicted;
+    }
+    copy(d.v, d.v + kAppearanceBins, m_rows.begin() + row * kAppearanceBins);
+    m_ids[row] = id;
+    m_lostTs[row] = m_usedTs[row] = tsMs;
+    ++m_st.added;
+}
+
+int AppearanceGallery::match(const AppearanceDescriptor& d, double tsMs, float minSimilarity, float* similarity)
+{
+    double t0 = nowMs();
+    int bestRow = -1;
+    float best = minSimilarity;
+    const float* row = m_rows.data();
+    for (size_t i = 0; i < m_ids.size(); ++i, row += kAppearanceBins)
+    {
+        if (m_ids[i] == 0) continue;
+        if (m_maxAgeMs > 0 && tsMs - m_lostTs[i] > m_maxAgeMs)
+        {
+            m_ids[i] = 0;
+            ++m_st.expired;
+            continue;
+        }
+        float s = dot(d.v, row);
+        if (s >= best)
+        {
+            best = s;
+            bestRow = (int)i;
+        }
+    }
+    double us = (nowMs() - t0) * 1000.0;
+    ++m_st.queries;
+    m_querySum += us;
+    m_st.avgQueryUs = m_querySum / m_st.queries;
+    m_st.maxQueryUs = max(m_st.maxQueryUs, us);
+    if (bestRow < 0) return 0;
+    ++m_st.matches;
+    m_usedTs[bestRow] = tsMs;
+    if (similarity) *similarity = best;
+    return m_ids[bestRow];
+}
+
+bool AppearanceGallery::remove(int id)
+{
+    auto it = find(m_ids.begin(), m_ids.end(), id);
+    if (id == 0 || it == m_ids.end()) return false;
+    *it = 0;
+    return true;
+}
+
+void AppearanceGallery::clear()
+{
+    fill(m_ids.begin(), m_ids.end(), 0);
+}
@@ -0,0 +1,71 @@
+// AppearanceGallery.h
+// Appearance re-identification of lost tracks. A track's look is a 64-float descriptor: quantized
+// HSV histograms of the upper and lower half of the box (8 hue x 3 saturation bins plus 8 grey
+// levels each, so shirt and trousers count separately), stored as square roots of the normalised
+// histogram so a dot product is the Bhattacharyya coefficient (1 = same colours).
+// The gallery keeps the descriptors of recently lost tracks in a fixed block of rows, evicting the
+// least recently used one when full and ignoring ones older than maxAgeMs. match() is a linear
+// nearest-neighbour scan over the rows with lane-wise accumulators the compiler vectorizes:
+// a few microseconds for a few dozen entries.
+//
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+constexpr int kAppearanceBins = 64;
+
+struct AppearanceDescriptor
+{
+    alignas(32) float v[kAppearanceBins] = {};
+    int samples = 0;  // crops blended in, 0 = none yet
+};
+
+// Descriptor of box (image coords) in a BGR frame, false if the box is too small or off the frame
+bool computeAppearance(const cv::Mat& frame, const cv::Rect& box, AppearanceDescriptor& out);
+// Blend a new sample into a running descriptor (first sample is taken as is)
+void blendAppearance(AppearanceDescriptor& acc, const AppearanceDescriptor& sample, float alpha);
+// Bhattacharyya coefficient of two descriptors, 0..1
+float appearanceSimilarity(const AppearanceDescriptor& a, const AppearanceDescriptor& b);
+
+struct GalleryStats
+{
+    uint64_t added = 0;
+    uint64_t evicted = 0;    // pushed out by a newer loss while full
+    uint64_t expired = 0;    // older than maxAgeMs when looked at
+    uint64_t queries = 0;
+    uint64_t matches = 0;    // queries that re-identified a lost track
+    double avgQueryUs = 0.0;
+    double maxQueryUs = 0.0;
+};
+
+class AppearanceGallery
+{
+public:
+    explicit AppearanceGallery(size_t capacity = 32, double maxAgeMs = 10000.0);
+
+    // Resize (drops every entry)
+    void configure(size_t capacity, double maxAgeMs);
+    size_t capacity() const { return m_ids.size(); }
+    size_t size() const;
+
+    // Lost track id looked like d at tsMs; replaces an entry with the same id, else the LRU one when full
+    void add(int id, const AppearanceDescriptor& d, double tsMs);
+    // Id of the entry most similar to d with similarity >= minSimilarity, 0 if none. A hit counts
+    // as a use of that entry.
+    int match(const AppearanceDescriptor& d, double tsMs, float minSimilarity, float* similarity = nullptr);
+    bool remove(int id);
+    void clear();
+
+    const GalleryStats& stats() const { return m_st; }
+
+private:
+    double m_maxAgeMs;
+    std::vector<float> m_rows;  // capacity x kAppearanceBins, one descriptor per row
+    std::vector<int> m_ids;     // 0 = free row
+    std::vector<double> m_lostTs;
+    std::vector<double> m_usedTs;
+    GalleryStats m_st;
+    double m_querySum = 0.0;
+};
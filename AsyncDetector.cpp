@@ -0,0 +1,178 @@
+// AsyncDetector.cpp
+// Latest-wins detection worker, see AsyncDetector.h
+//
+
+#include "AsyncDetector.h"
+#include "SwcCommon.h"
+
+using namespace std;
+
+AsyncDetector::~AsyncDetector()
+{
+    stop();
+}
+
+void AsyncDetector::start(unique_ptr<PersonDetector> detector)
+{
+    if (running() || !detector) return;
+    m_detector = move(detector);
+    m_stopping = false;
+    for (Channel& c : m_channels) c = Channel();
+    m_st = AsyncDetectorStats();
+    m_detectSum = m_lagSum = 0.0;
+    m_thread = thread(&AsyncDetector::workerLoop, this);
+}
+
+void AsyncDetector::stop()
+{
+    if (!running()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    for (Channel& c : m_channels) c = Channel();
+}
+
+int AsyncDetector::addChannel()
+{
+    lock_guard<mutex> lk(m_mtx);
+    m_channels.emplace_back();
+    return (int)m_channels.size() - 1;
+}
+
+bool AsyncDetector::busy(int channel) const
+{
+    lock_guard<mutex> lk(m_mtx);
+    const Channel& c = m_channels.at(channel);
+    return c.hasRequest || c.working;
+}
+
+void AsyncDetector::submit(DetectRequest&& req, int channel)
+{
+    if (!req.frame || req.frame->empty()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        if (!running() || m_stopping) return;
+        Channel& c = m_channels.at(channel);
+        ++m_st.submitted;
+        if (c.hasRequest) ++m_st.superseded;
+        c.request = move(req);
+        c.hasRequest = true;
+    }
+    m_cv.notify_one();
+}
+
+bool AsyncDetector::poll(DetectResult& out, int channel)
+{
+    lock_guard<mutex> lk(m_mtx);
+    Channel& c = m_channels.at(channel);
+    if (!c.hasResult) return false;
+    out = move(c.result);
+    c.result = DetectResult();
+    c.hasResult = false;
+    return true;
+}
+
+void AsyncDetector::recordLag(double lagMs)
+{
+    lock_guard<mutex> lk(m_mtx);
+    ++m_st.lagSamples;
+    m_lagSum += lagMs;
+    m_st.avgLagMs = m_lagSum / m_st.lagSamples;
+    m_st.maxLagMs = max(m_st.maxLagMs, lagMs);
+}
+
+AsyncDetectorStats AsyncDetector::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_st;
+}
+
+void AsyncDetector::workerLoop()
+{
+    // pre-warm here, not on the caller's (UI) thread
+    double t = nowMs();
+    m_detector->warmUp();
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_st.warmUpMs = nowMs() - t;
+    }
+
+    size_t maxBatch = (size_t)max(1, m_detector->maxBatch());
+    vector<cv::Mat> bufs;
+    for (;;)
+    {
+        // take every pending request (up to the detector's batch size), lowest channel first
+        vector<int> ids;
+        vector<DetectRequest> reqs;
+        {
+            unique_lock<mutex> lk(m_mtx);
+            auto pending = [&] 
+            {
+                for (const Channel& c : m_channels) if (c.hasRequest) return true;
+                return false;
+            };
+            m_cv.wait(lk, [&] { return m_stopping || pending(); });
+            if (m_stopping) return;
+            for (size_t i = 0; i < m_channels.size() && reqs.size() < maxBatch; ++i) 
+            {
+                Channel& c = m_channels[i];
+                if (!c.hasRequest) continue;
+                ids.push_back((int)i);
+                reqs.push_back(move(c.request));
+                c.request = DetectRequest();
+                c.hasRequest = false;
+                c.working = true;
+            }
+        }
+
+        t = nowMs();
+        bufs.resize(reqs.size());
+        vector<cv::Mat> inputs;
+        vector<size_t> inputOf(reqs.size(), SIZE_MAX);
+        vector<cv::Rect> rois(reqs.size());
+        vector<double> scales(reqs.size());
+        for (size_t i = 0; i < reqs.size(); ++i) 
+        {
+            const cv::Mat& f = *reqs[i].frame;
+            rois[i] = reqs[i].roi & cv::Rect(0, 0, f.cols, f.rows);
+            scales[i] = reqs[i].scale;
+            cv::Mat in = roiInput(*m_detector, f, rois[i], scales[i], bufs[i]);
+            if (in.empty()) continue;
+            inputOf[i] = inputs.size();
+            inputs.push_back(in);
+        }
+        vector<vector<cv::Rect>> found;
+        if (!inputs.empty()) m_detector->detectBatch(inputs, found);
+        double ms = nowMs() - t;
+
+        lock_guard<mutex> lk(m_mtx);
+        if (!inputs.empty()) ++m_st.batches;
+        for (size_t i = 0; i < reqs.size(); ++i) 
+        {
+            Channel& c = m_channels[ids[i]];
+            DetectResult res;
+            if (inputOf[i] != SIZE_MAX && inputOf[i] < found.size()) 
+            {
+                res.detections = move(found[inputOf[i]]);
+                mapFromRoi(rois[i], scales[i], res.detections);
+            }
+            res.detectMs = ms;
+            res.req = move(reqs[i]);
+            c.working = false;
+            if (c.hasResult) ++m_st.unread;
+            c.result = move(res);
+            c.hasResult = true;
+            ++m_st.completed;
+        }
+        // detect time per batch, lag per result
+        if (!inputs.empty()) 
+        {
+            m_detectSum += ms;
+            m_st.avgDetectMs = m_detectSum / m_st.batches;
+            m_st.maxDetectMs = max(m_st.maxDetectMs, ms);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+// AsyncDetector.h
+// Person detection on its own thread so HOG (or a DNN) never stalls the preview.
+// One request slot per channel, latest wins: a request submitted while another is still waiting
+// replaces it. Results are latched with the request (source FrameRef and its timestamp); the engine
+// picks them up on a later frame and forwards them to that frame itself. The detector is warmed up
+// on the worker thread before the first request.
+// Several engines (cameras) can share one detector, each on its own channel; requests pending on
+// several channels go through the detector as one batch (detectBatch, e.g. one DNN blob).
+//
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "FramePool.h"
+#include "PersonDetector.h"
+
+struct DetectRequest
+{
+    FrameRef frame;        // source frame, kept alive until the result is consumed
+    double tsMs = 0.0;     // its capture time
+    cv::Rect roi;          // full-res area to scan
+    double scale = 1.0;    // roi resize before detection
+    cv::Rect candidate;    // contour candidate or track box being verified, empty for a fallback scan
+    int track = 0;         // id of the track the candidate belongs to (TrackManager)
+    bool reacquire = false; // roi is the search window of lost track `track`, candidate its predicted box
+};
+
+struct DetectResult
+{
+    DetectRequest req;
+    std::vector<cv::Rect> detections; // full-res coords of the source frame
+    double detectMs = 0.0;
+};
+
+struct AsyncDetectorStats
+{
+    uint64_t submitted = 0;
+    uint64_t superseded = 0;  // replaced in the slot before the worker got to them
+    uint64_t completed = 0;
+    uint64_t batches = 0;     // detector calls, completed / batches = average batch size
+    uint64_t unread = 0;      // finished but replaced by a newer result before poll()
+    double warmUpMs = 0.0;
+    double avgDetectMs = 0.0;
+    double maxDetectMs = 0.0;
+    uint64_t lagSamples = 0;  // results consumed by the engine
+    double avgLagMs = 0.0;    // source frame -> frame the result was applied to
+    double maxLagMs = 0.0;
+};
+
+class AsyncDetector
+{
+public:
+    AsyncDetector() = default;
+    ~AsyncDetector();
+    AsyncDetector(const AsyncDetector&) = delete;
+    AsyncDetector& operator=(const AsyncDetector&) = delete;
+
+    void start(std::unique_ptr<PersonDetector> detector);
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+    // Channel for another client (camera), channel 0 always exists
+    int addChannel();
+
+    // a request is waiting or being processed on the channel
+    bool busy(int channel = 0) const;
+
+    void submit(DetectRequest&& req, int channel = 0);
+    // Latest finished result of the channel, each one is returned once
+    bool poll(DetectResult& out, int channel = 0);
+    // Engine reports how far behind the frame a consumed result was
+    void recordLag(double lagMs);
+
+    AsyncDetectorStats stats() const;
+
+private:
+    void workerLoop();
+
+    struct Channel
+    {
+        bool hasRequest = false;
+        bool working = false;
+        bool hasResult = false;
+        DetectRequest request;
+        DetectResult result;
+    };
+
+    std::unique_ptr<PersonDetector> m_detector;
+    std::thread m_thread;
+    mutable std::mutex m_mtx;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+    std::deque<Channel> m_channels = std::deque<Channel>(1);
+    AsyncDetectorStats m_st;
+    double m_detectSum = 0.0;
+    double m_lagSum = 0.0;
+};
@@ -0,0 +1,82 @@
+// BoxPredictor.cpp
+// Constant-velocity box filter, see BoxPredictor.h
+//
+
+#include "BoxPredictor.h"
+
+using namespace std;
+
+// state: cx, cy, w, h, vx, vy; measurement: cx, cy, w, h
+void BoxPredictor::init(const cv::Rect2d& box)
+{
+    m_kf.init(6, 4, 0, CV_32F);
+    m_kf.transitionMatrix = cv::Mat::eye(6, 6, CV_32F);
+    m_kf.transitionMatrix.at<float>(0, 4) = 1.0f;
+    m_kf.transitionMatrix.at<float>(1, 5) = 1.0f;
+    cv::setIdentity(m_kf.measurementMatrix);
+
+    // a walking person moves a few % of their height per frame; the tracker box jitters by about as much
+    float h = (float)max(1.0, box.height);
+    float pos = 0.01f * h, size = 0.01f * h, vel = 0.01f * h, meas = 0.05f * h;
+    m_kf.processNoiseCov = cv::Mat::zeros(6, 6, CV_32F);
+    m_kf.processNoiseCov.at<float>(0, 0) = m_kf.processNoiseCov.at<float>(1, 1) = pos * pos;
+    m_kf.processNoiseCov.at<float>(2, 2) = m_kf.processNoiseCov.at<float>(3, 3) = size * size;
+    m_kf.processNoiseCov.at<float>(4, 4) = m_kf.processNoiseCov.at<float>(5, 5) = vel * vel;
+    cv::setIdentity(m_kf.measurementNoiseCov, cv::Scalar(meas * meas));
+    // velocity unknown at the start
+    m_kf.errorCovPost = cv::Mat::zeros(6, 6, CV_32F);
+    for (int i = 0; i < 4; ++i) m_kf.errorCovPost.at<float>(i, i) = meas * meas;
+    m_kf.errorCovPost.at<float>(4, 4) = m_kf.errorCovPost.at<float>(5, 5) = 4.0f * meas * meas;
+
+    m_kf.statePost = cv::Mat::zeros(6, 1, CV_32F);
+    m_kf.statePost.at<float>(0) = (float)(box.x + box.width / 2.0);
+    m_kf.statePost.at<float>(1) = (float)(box.y + box.height / 2.0);
+    m_kf.statePost.at<float>(2) = (float)box.width;
+    m_kf.statePost.at<float>(3) = (float)box.height;
+    m_init = true;
+}
+
+cv::Rect2d BoxPredictor::predict()
+{
+    if (!m_init) return cv::Rect2d();
+    m_kf.predict(); // also copies the prediction to statePost / errorCovPost
+    return box();
+}
+
+void BoxPredictor::correct(const cv::Rect2d& box)
+{
+    if (!m_init)
+    {
+        init(box);
+        return;
+    }
+    cv::Mat z(4, 1, CV_32F);
+    z.at<float>(0) = (float)(box.x + box.width / 2.0);
+    z.at<float>(1) = (float)(box.y + box.height / 2.0);
+    z.at<float>(2) = (float)box.width;
+    z.at<float>(3) = (float)box.height;
+    m_kf.correct(z);
+}
+
+cv::Rect2d BoxPredictor::box() const
+{
+    if (!m_init) return cv::Rect2d();
+    const cv::Mat& s = m_kf.statePost;
+    double w = max(1.0f, s.at<float>(2)), h = max(1.0f, s.at<float>(3));
+    return cv::Rect2d(s.at<float>(0) - w / 2.0, s.at<float>(1) - h / 2.0, w, h);
+}
+
+cv::Point2d BoxPredictor::velocity() const
+{
+    if (!m_init) return cv::Point2d();
+    return cv::Point2d(m_kf.statePost.at<float>(4), m_kf.statePost.at<float>(5));
+}
+
+cv::Rect2d BoxPredictor::searchWindow(double sigmas) const
+{
+    cv::Rect2d b = box();
+    if (!m_init) return b;
+    double padX = sigmas * sqrt(max(0.0f, m_kf.errorCovPost.at<float>(0, 0)));
+    double padY = sigmas * sqrt(max(0.0f, m_kf.errorCovPost.at<float>(1, 1)));
+    return cv::Rect2d(b.x - padX, b.y - padY, b.width + 2 * padX, b.height + 2 * padY);
+}
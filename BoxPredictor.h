@@ -0,0 +1,33 @@
+// BoxPredictor.h
+// Constant-velocity Kalman filter on a track box: state is the centre, the size and the centre's
+// velocity, one step per frame. While the tracker follows the target every box is fed back
+// (correct); after a loss it keeps predicting, and searchWindow() gives the area the target should
+// be in, growing with the prediction's uncertainty the longer it goes unseen.
+//
+
+#pragma once
+#include <opencv2/opencv.hpp>
+
+class BoxPredictor
+{
+public:
+    // Start at box with zero velocity; noise is relative to the box height
+    void init(const cv::Rect2d& box);
+    bool initialized() const { return m_init; }
+
+    // Advance one frame, the predicted box
+    cv::Rect2d predict();
+    // Measured box of the frame just predicted
+    void correct(const cv::Rect2d& box);
+
+    // Current estimate (after correct the filtered box, after predict the prediction)
+    cv::Rect2d box() const;
+    // Centre velocity in px per frame
+    cv::Point2d velocity() const;
+    // box() grown by sigmas standard deviations of the centre estimate on each side
+    cv::Rect2d searchWindow(double sigmas) const;
+
+private:
+    cv::KalmanFilter m_kf;
+    bool m_init = false;
+};
@@ -0,0 +1,112 @@
+// CaptureThread.cpp
+// Capture thread feeding the frame ring, see CaptureThread.h
+//
+
+#include "CaptureThread.h"
+#include "SwcCommon.h"
+#include <chrono>
+
+using namespace std;
+
+// pool covers the ring plus the frames consumers hold (current, preview, saver, in flight)
+CaptureThread::CaptureThread(size_t ringCapacity)
+    : m_pool(ringCapacity + 4), m_ring(ringCapacity)
+{
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+}
+
+bool CaptureThread::start(const CaptureSource& src)
+{
+    if (m_running) return false;
+    if (m_thread.joinable()) m_thread.join(); // previous file source ran to its end
+    m_ring.clear();
+    m_finished = false;
+    m_running = true;
+    // 0 = pending, 1 = opened, -1 = failed
+    atomic<int> openResult{ 0 };
+    m_thread = thread(&CaptureThread::run, this, src, &openResult);
+    while (openResult.load() == 0) this_thread::sleep_for(chrono::milliseconds(2));
+    if (openResult.load() < 0) 
+    {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void CaptureThread::stop()
+{
+    m_running = false;
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void CaptureThread::run(CaptureSource src, atomic<int>* openResult)
+{
+    cv::VideoCapture cap;
+    bool isFile = !src.path.empty();
+    if (isFile) cap.open(src.path, src.api);
+    else cap.open(src.device, src.api);
+    if (!cap.isOpened()) 
+    {
+        m_running = false;
+        openResult->store(-1);
+        return;
+    }
+    // keep the driver queue short, we want the newest frame not a backlog
+    if (!isFile) cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    int w = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH);
+    int h = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+    if (w > 0 && h > 0) m_pool.preallocate(cv::Size(w, h), CV_8UC3);
+    openResult->store(1); // openResult lives on the starter's stack, do not touch it after this
+
+    double frameMs = (src.paceFps > 0) ? 1000.0 / src.paceFps : 0.0;
+    double nextDue = nowMs();
+    uint64_t seq = 0;
+    while (m_running) 
+    {
+        if (frameMs > 0) 
+        {
+            double wait = nextDue - nowMs();
+            if (wait > 0) this_thread::sleep_for(chrono::duration<double, milli>(wait));
+            nextDue += frameMs;
+        }
+        shared_ptr<cv::Mat> buf = m_pool.acquire();
+        if (!cap.read(*buf) || buf->empty()) 
+        {
+            if (isFile) 
+            {
+                m_finished = true;
+                break;
+            }
+            m_readFailures.fetch_add(1, memory_order_relaxed);
+            this_thread::sleep_for(chrono::milliseconds(10));
+            continue;
+        }
+        TimedFrame tf;
+        tf.image = move(buf);
+        tf.tsMs = nowMs();
+        tf.seq = ++seq;
+        m_captured.fetch_add(1, memory_order_relaxed);
+        m_ring.push(move(tf));
+        if (m_frameReady) m_frameReady();
+    }
+    cap.release();
+    m_running = false;
+}
+
+CaptureStats CaptureThread::stats() const
+{
+    RingStats r = m_ring.stats();
+    CaptureStats s;
+    s.captured = m_captured.load(memory_order_relaxed);
+    s.readFailures = m_readFailures.load(memory_order_relaxed);
+    s.overwritten = r.overwritten;
+    s.dropped = r.dropped;
+    s.delivered = r.popped;
+    s.pool = m_pool.stats();
+    return s;
+}
@@ -0,0 +1,83 @@
+// CaptureThread.h
+// Dedicated capture thread: grabs frames from a camera or a file and pushes timestamped frames
+// into a FrameRing (latest-frame-wins), so a slow analysis stage never delays the next grab.
+// The capture device is opened on the capture thread itself (DirectShow likes that).
+// Frames are decoded straight into FramePool buffers, consumers share them through FrameRef.
+// An optional frame-ready callback (run on the capture thread right after each push) lets an
+// event-driven consumer wake up instead of polling latest() on a timer.
+//
+
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "FrameRing.h"
+#include "FramePool.h"
+
+struct TimedFrame
+{
+    FrameRef image;     // shared, immutable
+    double tsMs = 0.0;  // nowMs() right after the grab
+    uint64_t seq = 0;   // capture order, 1-based
+};
+
+// Camera index or file path; paceFps > 0 throttles file sources to real time
+struct CaptureSource
+{
+    int device = -1;
+    int api = cv::CAP_ANY;
+    std::string path;
+    double paceFps = 0.0;
+};
+
+struct CaptureStats
+{
+    uint64_t captured = 0;     // frames grabbed from the source
+    uint64_t readFailures = 0; // failed reads on a live device
+    uint64_t overwritten = 0;  // unread frames replaced in the ring (consumer too slow)
+    uint64_t dropped = 0;      // stale frames skipped by latest()
+    uint64_t delivered = 0;    // frames handed to the consumer
+    PoolStats pool;
+};
+
+class CaptureThread
+{
+public:
+    explicit CaptureThread(size_t ringCapacity = 4);
+    ~CaptureThread();
+    CaptureThread(const CaptureThread&) = delete;
+    CaptureThread& operator=(const CaptureThread&) = delete;
+
+    // Called on the capture thread after every new frame; keep it short (post a message, signal a
+    // condition). Set before start().
+    void setFrameReady(std::function<void()> cb) { m_frameReady = std::move(cb); }
+
+    // Opens the source on the capture thread and waits for the result
+    bool start(const CaptureSource& src);
+    void stop();
+    bool running() const { return m_running; }
+    // File source reached its end (a live device never finishes)
+    bool finished() const { return m_finished; }
+
+    // Consumer side (one consumer thread): newest frame, older unread ones are discarded
+    bool latest(TimedFrame& out) { return m_ring.popLatest(out); }
+    // Consumer side: oldest unread frame, for offline processing of every frame
+    bool next(TimedFrame& out) { return m_ring.pop(out); }
+
+    CaptureStats stats() const;
+
+private:
+    void run(CaptureSource src, std::atomic<int>* openResult);
+
+    FramePool m_pool;
+    FrameRing<TimedFrame> m_ring;
+    std::thread m_thread;
+    std::atomic<bool> m_running{ false };
+    std::atomic<bool> m_finished{ false };
+    std::atomic<uint64_t> m_captured{ 0 };
+    std::atomic<uint64_t> m_readFailures{ 0 };
+    std::function<void()> m_frameReady;
+};
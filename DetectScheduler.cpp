@@ -0,0 +1,105 @@
+// DetectScheduler.cpp
+// Adaptive detection cadence, see DetectScheduler.h
+//
+
+#include "DetectScheduler.h"
+#include <algorithm>
+
+using namespace std;
+
+DetectScheduler::DetectScheduler(const CadenceConfig& cfg)
+{
+    configure(cfg);
+}
+
+void DetectScheduler::configure(const CadenceConfig& cfg)
+{
+    m_cfg = cfg;
+    m_cfg.minInterval = max(1, m_cfg.minInterval);
+    m_cfg.maxInterval = max(m_cfg.minInterval, m_cfg.maxInterval);
+    reset();
+}
+
+void DetectScheduler::reset()
+{
+    m_st = CadenceStats();
+    m_interval = m_cfg.minInterval;
+    m_since = 0;
+    m_woken = true;
+    m_energy = 0.0;
+    m_baseline = -1.0;
+    m_spike = false;
+    m_prevThumb.release();
+}
+
+// Mean absolute luma difference between nearest-neighbour thumbnails of this and the previous
+// frame. Only thumbWidth x (proportional) pixels are read, so this costs next to nothing at 1080p.
+double DetectScheduler::measure(const cv::Mat& frame)
+{
+    int w = min(frame.cols, m_cfg.thumbWidth);
+    int h = max(1, (int)lround(frame.rows * (double)w / frame.cols));
+    cv::resize(frame, m_diff, cv::Size(w, h), 0, 0, cv::INTER_NEAREST);
+    if (m_diff.channels() == 3) cv::cvtColor(m_diff, m_thumb, cv::COLOR_BGR2GRAY);
+    else if (m_diff.channels() == 4) cv::cvtColor(m_diff, m_thumb, cv::COLOR_BGRA2GRAY);
+    else m_diff.copyTo(m_thumb);
+
+    double e = 0.0;
+    bool first = m_prevThumb.size() != m_thumb.size();
+    if (!first) 
+    {
+        cv::absdiff(m_thumb, m_prevThumb, m_diff);
+        e = cv::mean(m_diff)[0];
+    }
+    swap(m_thumb, m_prevThumb);
+    if (first) return -1.0;
+    return e;
+}
+
+bool DetectScheduler::next(const cv::Mat& frame)
+{
+    ++m_st.frames;
+    if (everyFrame()) 
+    {
+        ++m_st.detectorFrames;
+        return true;
+    }
+
+    double e = measure(frame);
+    m_spike = false;
+    if (e >= 0.0) 
+    {
+        m_energy = e;
+        if (m_baseline < 0.0) m_baseline = e;
+        m_spike = e >= m_cfg.spikeFloor && e > m_cfg.spikeRatio * m_baseline;
+        // a spike does not drag the average up, so a lasting change keeps reading as one for a while
+        if (!m_spike) m_baseline += m_cfg.energyAlpha * (e - m_baseline);
+        else m_baseline += m_cfg.energyAlpha * 0.25 * (e - m_baseline);
+    }
+    if (m_spike) 
+    {
+        ++m_st.spikes;
+        m_interval = m_cfg.minInterval;
+    }
+
+    ++m_since;
+    if (!m_woken && !m_spike && m_since < m_interval) return false;
+    m_woken = false;
+    m_since = 0;
+    ++m_st.detectorFrames;
+    return true;
+}
+
+void DetectScheduler::relax()
+{
+    m_interval = min(m_cfg.maxInterval, m_interval + 1);
+}
+
+void DetectScheduler::alert()
+{
+    m_interval = m_cfg.minInterval;
+}
+
+void DetectScheduler::wake()
+{
+    m_woken = true;
+}
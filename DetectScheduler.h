@@ -0,0 +1,69 @@
+// DetectScheduler.h
+// Decides which frames run the expensive detection path (motion auto-init, or re-verifying the
+// current track with the person detector); the frames in between only update the tracker.
+// The cadence adapts between minInterval and maxInterval frames: detector frames that find
+// nothing (or confirm a track) stretch it, a lost or unconfirmed person shrinks it back, and a
+// motion-energy spike (thumbnail frame difference well above its running average) forces a
+// detector frame at once and resets the cadence to minInterval.
+// minInterval == maxInterval == 1 detects on every frame.
+//
+
+#pragma once
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+struct CadenceConfig
+{
+    int minInterval = 1;        // frames between detector frames when busy
+    int maxInterval = 1;        // ... when the scene is calm
+    double spikeRatio = 3.0;    // energy above this multiple of its average is a spike
+    double spikeFloor = 2.0;    // and above this (mean abs luma difference, 0..255)
+    double energyAlpha = 0.05;  // running-average weight of the newest frame
+    int thumbWidth = 80;        // energy thumbnail width in pixels
+};
+
+struct CadenceStats
+{
+    uint64_t frames = 0;
+    uint64_t detectorFrames = 0;
+    uint64_t spikes = 0;
+};
+
+class DetectScheduler
+{
+public:
+    explicit DetectScheduler(const CadenceConfig& cfg = CadenceConfig());
+    void configure(const CadenceConfig& cfg);
+    void reset();
+
+    // Once per frame: measures the motion energy and returns true on a detector frame
+    bool next(const cv::Mat& frame);
+    // Outcome of a detector frame. relax: nothing moving, or the track was confirmed (one frame
+    // longer interval). alert: the track failed verification (back to minInterval).
+    void relax();
+    void alert();
+    // Detect on the next frame regardless of the cadence (e.g. the track was lost)
+    void wake();
+
+    bool everyFrame() const { return m_cfg.maxInterval <= 1; }
+    int interval() const { return m_interval; }
+    double energy() const { return m_energy; }
+    double baseline() const { return m_baseline; }
+    bool spike() const { return m_spike; }
+    const CadenceStats& stats() const { return m_st; }
+
+private:
+    double measure(const cv::Mat& frame);
+
+    CadenceConfig m_cfg;
+    CadenceStats m_st;
+    int m_interval = 1;
+    int m_since = 0;         // frames since the last detector frame
+    bool m_woken = true;
+    double m_energy = 0.0;
+    double m_baseline = -1.0; // < 0 until the first difference
+    bool m_spike = false;
+    cv::Mat m_thumb;
+    cv::Mat m_prevThumb;
+    cv::Mat m_diff;
+};
@@ -0,0 +1,160 @@
+// DnnPersonDetector.cpp
+// cv::dnn person detector with batched inference, see DnnPersonDetector.h
+//
+
+#include "DnnPersonDetector.h"
+#include "SwcCommon.h"
+
+using namespace std;
+
+DnnPersonDetector::DnnPersonDetector(const DnnDetectorConfig& cfg)
+    : m_cfg(cfg)
+{
+    try
+    {
+        m_net = cv::dnn::readNet(cfg.model, cfg.config);
+        if (!m_net.empty())
+        {
+            m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+            m_outNames = m_net.getUnconnectedOutLayersNames();
+        }
+    }
+    catch (const cv::Exception& e)
+    {
+        m_error = e.what();
+        m_net = cv::dnn::Net();
+    }
+    if (m_net.empty() && m_error.empty()) m_error = "cannot load " + cfg.model;
+}
+
+void DnnPersonDetector::warmUp()
+{
+    if (!loaded()) return;
+    // first forward pass allocates the layer buffers
+    vector<cv::Rect> found;
+    detect(cv::Mat(m_cfg.inputSize, CV_8UC3, cv::Scalar(0, 0, 0)), found);
+    m_st = DnnDetectorStats();
+    m_inferSum = 0.0;
+}
+
+void DnnPersonDetector::detect(const cv::Mat& image, vector<cv::Rect>& found)
+{
+    vector<vector<cv::Rect>> batch;
+    detectBatch(vector<cv::Mat>{ image }, batch);
+    found = batch.empty() ? vector<cv::Rect>() : move(batch[0]);
+}
+
+void DnnPersonDetector::detectBatch(const vector<cv::Mat>& images, vector<vector<cv::Rect>>& found)
+{
+    found.assign(images.size(), vector<cv::Rect>());
+    if (!loaded() || images.empty()) return;
+    if ((int)images.size() > max(1, m_cfg.maxBatch))
+    {
+        // split oversized batches
+        for (size_t i = 0; i < images.size(); i += m_cfg.maxBatch)
+        {
+            vector<cv::Mat> part(images.begin() + i, images.begin() + min(images.size(), i + m_cfg.maxBatch));
+            vector<vector<cv::Rect>> partFound;
+            detectBatch(part, partFound);
+            for (size_t j = 0; j < partFound.size(); ++j) found[i + j] = move(partFound[j]);
+        }
+        return;
+    }
+
+    double t = nowMs();
+    vector<cv::Mat> outs;
+    try
+    {
+        cv::Mat blob = cv::dnn::blobFromImages(images, m_cfg.scale, m_cfg.inputSize, m_cfg.mean, m_cfg.swapRB, false);
+        m_net.setInput(blob);
+        m_net.forward(outs, m_outNames);
+    }
+    catch (const cv::Exception& e)
+    {
+        if (images.size() > 1)
+        {
+            // many exports have a fixed batch of 1, fall back to one image per pass
+            swcLog(string("DNN detector: batched forward failed, batch size 1 from now on: ") + e.what());
+            m_cfg.maxBatch = 1;
+            detectBatch(images, found);
+        }
+        else
+        {
+            swcLog(string("DNN detector: forward failed: ") + e.what());
+        }
+        return;
+    }
+    if (!outs.empty()) parse(outs[0], images, found);
+
+    double ms = nowMs() - t;
+    ++m_st.inferences;
+    m_st.images += images.size();
+    m_inferSum += ms;
+    m_st.avgInferMs = m_inferSum / m_st.inferences;
+    m_st.maxInferMs = max(m_st.maxInferMs, ms);
+    m_st.imagesPerSec = m_inferSum > 0 ? m_st.images * 1000.0 / m_inferSum : 0.0;
+}
+
+void DnnPersonDetector::parse(const cv::Mat& out, const vector<cv::Mat>& images, vector<vector<cv::Rect>>& found) const
+{
+    size_t batch = images.size();
+    vector<vector<cv::Rect>> boxes(batch);
+    vector<vector<float>> scores(batch);
+    const float* d = out.ptr<float>();
+    int last = out.size[out.dims - 1];
+
+    if (last == 7)
+    {
+        // SSD: [1, 1, N, 7] (image, class, conf, x1, y1, x2, y2), coords relative to the image
+        size_t n = out.total() / 7;
+        for (size_t i = 0; i < n; ++i, d += 7)
+        {
+            int img = (int)d[0];
+            if (img < 0 || (size_t)img >= batch || (int)d[1] != m_cfg.personClass || d[2] < m_cfg.confThreshold) continue;
+            const cv::Mat& im = images[img];
+            cv::Rect r(cv::Point((int)(d[3] * im.cols), (int)(d[4] * im.rows)),
+                       cv::Point((int)(d[5] * im.cols), (int)(d[6] * im.rows)));
+            boxes[img].push_back(r & cv::Rect(0, 0, im.cols, im.rows));
+            scores[img].push_back(d[2]);
+        }
+    }
+    else if (out.dims >= 2)
+    {
+        // YOLO: v5 [B, N, 5 + C] with objectness, or v8 [B, 4 + C, N] without; cx, cy, w, h in input pixels
+        int b = out.dims == 3 ? out.size[0] : 1;
+        int a = out.size[out.dims - 2];
+        bool v8 = a < last;
+        int n = v8 ? last : a;
+        int attrs = v8 ? a : last;
+        int clsOffset = v8 ? 4 : 5;
+        if (m_cfg.personClass + clsOffset >= attrs) return;
+        for (int img = 0; img < b && (size_t)img < batch; ++img)
+        {
+            const float* base = d + (size_t)img * n * attrs;
+            const cv::Mat& im = images[img];
+            double sx = im.cols / (double)m_cfg.inputSize.width;
+            double sy = im.rows / (double)m_cfg.inputSize.height;
+            for (int i = 0; i < n; ++i)
+            {
+                auto at = [&](int k) { return v8 ? base[(size_t)k * n + i] : base[(size_t)i * attrs + k]; };
+                float conf = at(clsOffset + m_cfg.personClass) * (v8 ? 1.0f : at(4));
+                if (conf < m_cfg.confThreshold) continue;
+                double cx = at(0) * sx, cy = at(1) * sy, w = at(2) * sx, h = at(3) * sy;
+                cv::Rect r((int)(cx - w / 2), (int)(cy - h / 2), (int)w, (int)h);
+                boxes[img].push_back(r & cv::Rect(0, 0, im.cols, im.rows));
+                scores[img].push_back(conf);
+            }
+        }
+    }
+
+    for (size_t img = 0; img < batch; ++img)
+    {
+        vector<int> keep;
+        cv::dnn::NMSBoxes(boxes[img], scores[img], m_cfg.confThreshold, m_cfg.nmsThreshold, keep);
+        for (int k : keep)
+        {
+            if (boxes[img][k].area() > 0) found[img].push_back(boxes[img][k]);
+        }
+    }
+}
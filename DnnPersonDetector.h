@@ -0,0 +1,67 @@
+// DnnPersonDetector.h
+// CPU person detector on cv::dnn (OpenCV backend, CPU target), as an alternative to HOG.
+// Loads a local model:
+//   - Caffe or ONNX SSD (e.g. MobileNet-SSD): output [1, 1, N, 7] = image, class, conf, x1, y1, x2, y2
+//   - ONNX YOLO (v5 style [B, N, 5 + classes] or v8 style [B, 4 + classes, N])
+// The output layout is recognised from its shape. Several images go through one forward pass
+// (detectBatch), which is how pending frames from several cameras are served together.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+#include "PersonDetector.h"
+
+struct DnnDetectorConfig
+{
+    std::string model;        // .onnx, .caffemodel (+ config), anything cv::dnn::readNet accepts
+    std::string config;       // .prototxt for Caffe, empty otherwise
+    cv::Size inputSize = cv::Size(300, 300); // 640x640 for most YOLO exports
+    double scale = 1.0 / 127.5; // pixel scale, MobileNet-SSD: (x - 127.5) / 127.5; YOLO: 1 / 255
+    cv::Scalar mean = cv::Scalar(127.5, 127.5, 127.5);
+    bool swapRB = false;      // YOLO exports expect RGB
+    int personClass = 15;     // VOC MobileNet-SSD: 15, COCO (YOLO): 0
+    float confThreshold = 0.5f;
+    float nmsThreshold = 0.45f;
+    int maxBatch = 8;
+};
+
+struct DnnDetectorStats
+{
+    uint64_t inferences = 0;  // forward passes
+    uint64_t images = 0;      // images through them
+    double avgInferMs = 0.0;  // per forward pass (blob + forward + parse)
+    double maxInferMs = 0.0;
+    double imagesPerSec = 0.0; // over inference time only
+};
+
+class DnnPersonDetector : public PersonDetector
+{
+public:
+    explicit DnnPersonDetector(const DnnDetectorConfig& cfg);
+    // false when the model could not be loaded (detect() then finds nothing)
+    bool loaded() const { return !m_net.empty(); }
+    const std::string& error() const { return m_error; }
+
+    const char* name() const override { return "dnn"; }
+    void warmUp() override;
+    bool resizesInput() const override { return true; }
+    int maxBatch() const override { return m_cfg.maxBatch; }
+    void detect(const cv::Mat& image, std::vector<cv::Rect>& found) override;
+    void detectBatch(const std::vector<cv::Mat>& images, std::vector<std::vector<cv::Rect>>& found) override;
+
+    DnnDetectorStats stats() const { return m_st; }
+
+private:
+    void parse(const cv::Mat& out, const std::vector<cv::Mat>& images, std::vector<std::vector<cv::Rect>>& found) const;
+
+    DnnDetectorConfig m_cfg;
+    cv::dnn::Net m_net;
+    std::vector<std::string> m_outNames;
+    std::string m_error;
+    DnnDetectorStats m_st;
+    double m_inferSum = 0.0;
+};
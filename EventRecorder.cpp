@@ -0,0 +1,214 @@
+// EventRecorder.cpp
+// Pre-roll ring + event clips, see EventRecorder.h
+//
+
+#include "EventRecorder.h"
+#include "SwcCommon.h"
+
+using namespace std;
+
+EventRecorder::~EventRecorder()
+{
+    stop();
+}
+
+void EventRecorder::start(const EventRecorderConfig& cfg)
+{
+    if (running()) return;
+    m_cfg = cfg;
+    m_stopping = false;
+    m_st = EventRecorderStats();
+    m_encodeMsSum = 0.0;
+    m_lastAcceptedTs = -1e18;
+    m_thread = thread(&EventRecorder::run, this);
+}
+
+void EventRecorder::stop()
+{
+    if (!running()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    lock_guard<mutex> lk(m_mtx);
+    m_pending.reset();
+    m_triggerPending = false;
+    m_ring.clear();
+    m_spare.clear();
+    m_ringBytes = 0;
+}
+
+void EventRecorder::push(const FrameRef& frame, double tsMs)
+{
+    if (!frame || frame->empty()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        if (m_stopping || tsMs - m_lastAcceptedTs < 1000.0 / m_cfg.fps) 
+        {
+            ++m_st.framesSkipped;
+            return;
+        }
+        if (m_pending) ++m_st.framesSkipped; // worker still busy with the previous one
+        m_pending = frame;
+        m_pendingTs = tsMs;
+        m_lastAcceptedTs = tsMs;
+    }
+    m_cv.notify_one();
+}
+
+void EventRecorder::trigger(const char* reason)
+{
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_activeUntil = nowMs() + m_cfg.postRollMs;
+        if (m_clipOpen || m_triggerPending) return;
+        m_triggerPending = true;
+        m_triggerReason = reason ? reason : "";
+    }
+    m_cv.notify_one();
+}
+
+void EventRecorder::extend()
+{
+    lock_guard<mutex> lk(m_mtx);
+    if (m_clipOpen || m_triggerPending) m_activeUntil = nowMs() + m_cfg.postRollMs;
+}
+
+bool EventRecorder::recording() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_clipOpen || m_triggerPending;
+}
+
+void EventRecorder::openClip(const string& reason)
+{
+    ArchiveConfig ac;
+    ac.dir = m_cfg.dir + "/" + timestampFilename();
+    ac.retention = m_cfg.retention;
+    bool ok = m_clip.open(ac);
+    lock_guard<mutex> lk(m_mtx);
+    m_clipOpen = ok;
+    if (ok) ++m_st.events;
+    swcLog(ok ? "Event: clip started (" + reason + ") -> " + ac.dir : "Event: cannot create clip in " + ac.dir);
+}
+
+void EventRecorder::writeClip(const Encoded& e)
+{
+    if (m_clip.append(e.wallUs, cv::Rect(), e.jpeg) < 0) return;
+    lock_guard<mutex> lk(m_mtx);
+    ++m_st.clipFrames;
+    m_st.clipBytes += e.jpeg.size();
+}
+
+void EventRecorder::closeClip()
+{
+    m_clip.close();
+    lock_guard<mutex> lk(m_mtx);
+    m_clipOpen = false;
+    swcLog("Event: clip closed");
+}
+
+size_t EventRecorder::footprintLocked() const
+{
+    size_t bytes = 0;
+    for (auto& e : m_ring) bytes += e.jpeg.capacity() + sizeof(Encoded);
+    for (auto& b : m_spare) bytes += b.capacity();
+    return bytes;
+}
+
+void EventRecorder::run()
+{
+    const vector<int> params = { cv::IMWRITE_JPEG_QUALITY, m_cfg.quality };
+    for (;;) 
+    {
+        FrameRef frame;
+        double ts = 0.0;
+        bool trig = false;
+        string reason;
+        {
+            unique_lock<mutex> lk(m_mtx);
+            m_cv.wait(lk, [&] { return m_stopping || m_pending || m_triggerPending; });
+            if (m_stopping) break;
+            frame = move(m_pending);
+            m_pending.reset();
+            ts = m_pendingTs;
+            trig = m_triggerPending;
+            reason = m_triggerReason;
+        }
+
+        if (trig) 
+        {
+            // flush the pre-roll first, the ring only changes on this thread
+            double t0 = nowMs();
+            openClip(reason);
+            if (m_clipOpen) 
+            {
+                for (auto& e : m_ring) 
+                {
+                    if (e.tsMs >= t0 - m_cfg.preRollMs) writeClip(e);
+                }
+            }
+            double flushMs = nowMs() - t0;
+            lock_guard<mutex> lk(m_mtx);
+            m_triggerPending = false;
+            m_st.lastFlushMs = flushMs;
+            m_st.maxFlushMs = max(m_st.maxFlushMs, flushMs);
+        }
+
+        if (frame) 
+        {
+            Encoded e;
+            if (!m_spare.empty()) 
+            {
+                e.jpeg = move(m_spare.back());
+                m_spare.pop_back();
+            }
+            double t = nowMs();
+            bool ok = cv::imencode(".jpg", *frame, e.jpeg, params);
+            double encodeMs = nowMs() - t;
+            frame.reset();
+            if (ok) 
+            {
+                e.tsMs = ts;
+                e.wallUs = steadyToWallUs(ts);
+                if (m_clipOpen) writeClip(e);
+
+                lock_guard<mutex> lk(m_mtx);
+                ++m_st.framesEncoded;
+                m_encodeMsSum += encodeMs;
+                m_ringBytes += e.jpeg.size();
+                m_ring.push_back(move(e));
+                // byte budget, always keep the newest frame
+                while (m_ringBytes > m_cfg.ringBytes && m_ring.size() > 1) 
+                {
+                    m_ringBytes -= m_ring.front().jpeg.size();
+                    if (m_spare.size() < 4) m_spare.push_back(move(m_ring.front().jpeg));
+                    m_ring.pop_front();
+                }
+                m_st.peakFootprint = max(m_st.peakFootprint, footprintLocked());
+            }
+        }
+
+        bool expired = false;
+        {
+            lock_guard<mutex> lk(m_mtx);
+            expired = m_clipOpen && nowMs() > m_activeUntil;
+        }
+        if (expired) closeClip();
+    }
+    if (m_clipOpen) closeClip();
+}
+
+EventRecorderStats EventRecorder::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    EventRecorderStats s = m_st;
+    s.ringFrames = m_ring.size();
+    s.ringBytes = m_ringBytes;
+    s.ringFootprint = footprintLocked();
+    s.ringSpanMs = m_ring.empty() ? 0.0 : m_ring.back().tsMs - m_ring.front().tsMs;
+    if (m_st.framesEncoded) s.avgEncodeMs = m_encodeMsSum / m_st.framesEncoded;
+    return s;
+}
@@ -0,0 +1,108 @@
+// EventRecorder.h
+// Pre-roll event recorder: keeps the last few seconds of JPEG-encoded frames in a ring bounded in
+// bytes. When an event fires (tracker auto-init) the pre-roll is flushed into an event clip and live
+// frames keep being appended until postRollMs after the last trigger/extend.
+// Clips are small FrameArchive directories (events/<timestamp>/), exportable with swccli --export-archive.
+// Encoding and clip writes run on the recorder's own thread; push() never blocks on it.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "FramePool.h"
+#include "FrameArchive.h"
+
+struct EventRecorderConfig
+{
+    std::string dir = "captures/events";
+    size_t ringBytes = 24u << 20;  // pre-roll memory budget
+    double preRollMs = 5000.0;     // how much of the ring goes into a clip
+    double postRollMs = 5000.0;    // keep recording this long after the last trigger/extend
+    double fps = 10.0;             // frames kept per second (input is decimated)
+    int quality = 80;
+    RetentionManager* retention = nullptr; // passed on to the clip archives
+};
+
+struct EventRecorderStats
+{
+    uint64_t events = 0;
+    uint64_t framesEncoded = 0;
+    uint64_t framesSkipped = 0;   // decimated or superseded before the worker got to them
+    uint64_t clipFrames = 0;
+    uint64_t clipBytes = 0;
+    size_t ringFrames = 0;
+    size_t ringBytes = 0;         // payload bytes held
+    size_t ringFootprint = 0;     // allocated bytes (buffer capacities), what the ring really costs
+    size_t peakFootprint = 0;
+    double ringSpanMs = 0.0;      // time covered by the ring
+    double avgEncodeMs = 0.0;
+    double lastFlushMs = 0.0;     // trigger -> pre-roll on disk
+    double maxFlushMs = 0.0;
+};
+
+class EventRecorder
+{
+public:
+    EventRecorder() = default;
+    ~EventRecorder();
+    EventRecorder(const EventRecorder&) = delete;
+    EventRecorder& operator=(const EventRecorder&) = delete;
+
+    void start(const EventRecorderConfig& cfg = EventRecorderConfig());
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+
+    // Offer a frame (tsMs = nowMs() at capture). Frames arriving faster than cfg.fps are skipped.
+    void push(const FrameRef& frame, double tsMs);
+    // Start an event clip (or extend the running one)
+    void trigger(const char* reason);
+    // Keep a running clip alive (e.g. while the tracker holds a target), no-op when idle
+    void extend();
+    bool recording() const;
+
+    EventRecorderStats stats() const;
+
+private:
+    struct Encoded
+    {
+        std::vector<uchar> jpeg;
+        double tsMs = 0.0;
+        int64_t wallUs = 0;
+    };
+
+    void run();
+    void openClip(const std::string& reason);
+    void writeClip(const Encoded& e);
+    void closeClip();
+    size_t footprintLocked() const;
+
+    EventRecorderConfig m_cfg;
+    std::thread m_thread;
+    mutable std::mutex m_mtx;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+
+    // producer -> worker hand-off, latest frame wins
+    FrameRef m_pending;
+    double m_pendingTs = 0.0;
+    double m_lastAcceptedTs = -1e18;
+    std::string m_triggerReason;
+    bool m_triggerPending = false;
+    double m_activeUntil = 0.0; // nowMs() deadline of the running clip
+
+    // worker-owned ring (stats read under m_mtx)
+    std::deque<Encoded> m_ring;
+    size_t m_ringBytes = 0;
+    std::vector<std::vector<uchar>> m_spare; // recycled encode buffers
+
+    ArchiveWriter m_clip;
+    bool m_clipOpen = false;
+    EventRecorderStats m_st;
+    double m_encodeMsSum = 0.0;
+};
@@ -0,0 +1,321 @@
+// FrameArchive.cpp
+// Segmented append-only archive, see FrameArchive.h
+//
+
+#include "FrameArchive.h"
+#include "SwcCommon.h"
+#include "RetentionManager.h"
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+namespace fs = filesystem;
+
+// index file = 16 byte header + ArchiveRecord[]
+static const char INDEX_MAGIC[8] = { 'S', 'W', 'C', 'I', 'D', 'X', '0', '1' };
+static const size_t INDEX_HEADER = 16;
+
+static bool seekFile(FILE* f, uint64_t off)
+{
+#if defined(_WIN32)
+    return _fseeki64(f, (long long)off, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)off, SEEK_SET) == 0;
+#endif
+}
+
+string archiveSegmentName(uint32_t seg, const char* ext)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "seg_%06u.%s", seg, ext);
+    return buf;
+}
+
+// segment numbers of all index files in dir, ascending
+static vector<uint32_t> listSegments(const string& dir)
+{
+    vector<uint32_t> segs;
+    error_code ec;
+    for (auto& e : fs::directory_iterator(dir, ec)) 
+    {
+        string name = e.path().filename().string();
+        unsigned seg = 0;
+        char ext[8] = {};
+        if (sscanf(name.c_str(), "seg_%u.%3s", &seg, ext) == 2 && strcmp(ext, "idx") == 0) segs.push_back(seg);
+    }
+    sort(segs.begin(), segs.end());
+    return segs;
+}
+
+// ArchiveWriter
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close();
+}
+
+bool ArchiveWriter::open(const ArchiveConfig& cfg)
+{
+    lock_guard<mutex> lk(m_mtx);
+    closeSegment();
+    m_cfg = cfg;
+    m_st = ArchiveStats();
+    m_lastTs = 0;
+    error_code ec;
+    fs::create_directories(m_cfg.dir, ec);
+
+    // resume after the newest segment, keep timestamps monotonic across restarts
+    vector<uint32_t> segs = listSegments(m_cfg.dir);
+    uint32_t next = segs.empty() ? 1 : segs.back() + 1;
+    if (!segs.empty()) 
+    {
+        FILE* f = fopen((m_cfg.dir + "/" + archiveSegmentName(segs.back(), "idx")).c_str(), "rb");
+        if (f) 
+        {
+            fseek(f, 0, SEEK_END);
+            long bytes = ftell(f);
+            long n = (bytes > (long)INDEX_HEADER) ? (bytes - (long)INDEX_HEADER) / (long)sizeof(ArchiveRecord) : 0;
+            ArchiveRecord r;
+            if (n > 0 && seekFile(f, INDEX_HEADER + (n - 1) * sizeof(ArchiveRecord)) && fread(&r, sizeof(r), 1, f) == 1) 
+                m_lastTs = r.tsUs;
+            fclose(f);
+        }
+    }
+    return openSegment(next);
+}
+
+bool ArchiveWriter::openSegment(uint32_t seg)
+{
+    m_dataPath = m_cfg.dir + "/" + archiveSegmentName(seg, "dat");
+    m_indexPath = m_cfg.dir + "/" + archiveSegmentName(seg, "idx");
+    // pinned until closeSegment: retention must not delete the segment being appended to
+    if (m_cfg.retention) 
+    {
+        m_cfg.retention->pin(m_dataPath);
+        m_cfg.retention->pin(m_indexPath);
+    }
+    m_data = fopen(m_dataPath.c_str(), "wb");
+    m_index = fopen(m_indexPath.c_str(), "wb");
+    if (!m_data || !m_index) 
+    {
+        closeSegment();
+        swcLog("Archive: cannot create segment in " + m_cfg.dir);
+        return false;
+    }
+    char header[INDEX_HEADER] = {};
+    memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    uint32_t recSize = sizeof(ArchiveRecord);
+    memcpy(header + 8, &recSize, sizeof(recSize));
+    fwrite(header, 1, sizeof(header), m_index);
+    fflush(m_index);
+    if (m_cfg.retention) m_cfg.retention->add(m_indexPath, sizeof(header));
+    m_seg = seg;
+    m_dataSize = 0;
+    ++m_st.segments;
+    return true;
+}
+
+void ArchiveWriter::closeSegment()
+{
+    if (m_data) fclose(m_data);
+    if (m_index) fclose(m_index);
+    m_data = nullptr;
+    m_index = nullptr;
+    if (m_cfg.retention && !m_dataPath.empty()) 
+    {
+        m_cfg.retention->unpin(m_dataPath);
+        m_cfg.retention->unpin(m_indexPath);
+    }
+}
+
+void ArchiveWriter::close()
+{
+    lock_guard<mutex> lk(m_mtx);
+    closeSegment();
+}
+
+bool ArchiveWriter::isOpen() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_data != nullptr;
+}
+
+bool ArchiveWriter::appendRecord(int64_t tsUs, ArchiveKind kind, const cv::Rect& rect, const vector<uchar>& data)
+{
+    ArchiveRecord r = {};
+    r.tsUs = tsUs;
+    r.offset = m_dataSize;
+    r.size = (uint32_t)data.size();
+    r.kind = kind;
+    r.x = rect.x; r.y = rect.y; r.w = rect.width; r.h = rect.height;
+
+    // payload first, then its index record
+    if (fwrite(data.data(), 1, data.size(), m_data) != data.size() || fflush(m_data) != 0 ||
+        fwrite(&r, sizeof(r), 1, m_index) != 1 || fflush(m_index) != 0) 
+    {
+        ++m_st.failures;
+        return false;
+    }
+    m_dataSize += data.size();
+    m_lastTs = tsUs;
+    if (m_cfg.retention) 
+    {
+        m_cfg.retention->add(m_dataPath, data.size());
+        m_cfg.retention->add(m_indexPath, sizeof(r));
+    }
+    ++m_st.records;
+    m_st.bytes += data.size();
+    return true;
+}
+
+int64_t ArchiveWriter::append(int64_t tsUs, const cv::Rect& bbox, const vector<uchar>& full,
+    const cv::Rect& crop, const vector<uchar>* cropJpeg)
+{
+    lock_guard<mutex> lk(m_mtx);
+    if (!m_data) return -1;
+    size_t size = full.size() + (cropJpeg ? cropJpeg->size() : 0);
+    if (m_dataSize > 0 && m_dataSize + size > m_cfg.maxSegmentBytes) 
+    {
+        closeSegment();
+        if (!openSegment(m_seg + 1)) { ++m_st.failures; return -1; }
+    }
+    // several encoder workers may finish out of order
+    if (tsUs <= m_lastTs) 
+    {
+        tsUs = m_lastTs + 1;
+        ++m_st.clampedTs;
+    }
+    if (!appendRecord(tsUs, ARCHIVE_FULL, bbox, full)) return -1;
+    if (cropJpeg && !appendRecord(tsUs + 1, ARCHIVE_CROP, crop, *cropJpeg)) return -1;
+    return tsUs;
+}
+
+ArchiveStats ArchiveWriter::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_st;
+}
+
+// ArchiveReader
+
+ArchiveReader::~ArchiveReader()
+{
+    close();
+}
+
+bool ArchiveReader::open(const string& dir)
+{
+    close();
+    for (uint32_t seg : listSegments(dir)) 
+    {
+        Segment s;
+        s.seg = seg;
+        s.dataPath = dir + "/" + archiveSegmentName(seg, "dat");
+        string idxPath = dir + "/" + archiveSegmentName(seg, "idx");
+#if defined(_WIN32)
+        HANDLE f = CreateFileA(idxPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (f == INVALID_HANDLE_VALUE) continue;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(f, &sz) || (size_t)sz.QuadPart <= INDEX_HEADER) { CloseHandle(f); continue; }
+        HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+        void* p = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!p) 
+        {
+            if (m) CloseHandle(m);
+            CloseHandle(f);
+            continue;
+        }
+        s.file = f;
+        s.map = m;
+        s.mapBytes = (size_t)sz.QuadPart;
+#else
+        int fd = ::open(idxPath.c_str(), O_RDONLY);
+        if (fd < 0) continue;
+        struct stat sb;
+        if (fstat(fd, &sb) != 0 || (size_t)sb.st_size <= INDEX_HEADER) { ::close(fd); continue; }
+        void* p = mmap(nullptr, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) continue;
+        s.mapBytes = (size_t)sb.st_size;
+#endif
+        s.mapping = p;
+        const char* base = (const char*)p;
+        uint32_t recSize = 0;
+        memcpy(&recSize, base + 8, sizeof(recSize));
+        s.records = (const ArchiveRecord*)(base + INDEX_HEADER);
+        // a torn trailing record (crash mid-write) is ignored
+        s.count = (memcmp(base, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 && recSize == sizeof(ArchiveRecord))
+            ? (s.mapBytes - INDEX_HEADER) / sizeof(ArchiveRecord) : 0;
+        s.first = m_total;
+        m_total += s.count;
+        m_segs.push_back(s);
+    }
+    return !m_segs.empty();
+}
+
+void ArchiveReader::close()
+{
+    for (auto& s : m_segs) 
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(s.mapping);
+        CloseHandle((HANDLE)s.map);
+        CloseHandle((HANDLE)s.file);
+#else
+        munmap(s.mapping, s.mapBytes);
+#endif
+    }
+    m_segs.clear();
+    m_total = 0;
+}
+
+size_t ArchiveReader::segmentOf(size_t i) const
+{
+    // last segment whose first index is <= i (an empty segment shares its successor's first)
+    auto it = upper_bound(m_segs.begin(), m_segs.end(), i,
+        [](size_t v, const Segment& s) { return v < s.first; });
+    return (size_t)(it - m_segs.begin()) - 1;
+}
+
+const ArchiveRecord& ArchiveReader::record(size_t i) const
+{
+    const Segment& s = m_segs[segmentOf(i)];
+    return s.records[i - s.first];
+}
+
+size_t ArchiveReader::seek(int64_t tsUs) const
+{
+    // timestamps increase across segments too, so one binary search over the global index
+    size_t lo = 0, hi = m_total;
+    while (lo < hi) 
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (record(mid).tsUs < tsUs) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool ArchiveReader::readPayload(size_t i, vector<uchar>& out) const
+{
+    if (i >= m_total) return false;
+    const Segment& s = m_segs[segmentOf(i)];
+    const ArchiveRecord& r = s.records[i - s.first];
+    FILE* f = fopen(s.dataPath.c_str(), "rb");
+    if (!f) return false;
+    out.resize(r.size);
+    bool ok = seekFile(f, r.offset) && fread(out.data(), 1, r.size, f) == r.size;
+    fclose(f);
+    return ok;
+}
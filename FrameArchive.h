@@ -0,0 +1,131 @@
+// FrameArchive.h
+// Append-only segmented frame archive: JPEG payloads stored back-to-back in segment data files
+// (seg_NNNNNN.dat) with a fixed-size binary index per segment (seg_NNNNNN.idx).
+// Index records hold a monotonic timestamp, payload offset/size and the crop rect; the reader
+// memory-maps the index files and seeks by time with a binary search.
+// Data is written before its index record, a crash leaves at most an unindexed tail.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+class RetentionManager;
+
+enum ArchiveKind : uint16_t
+{
+    ARCHIVE_FULL = 0, // full frame, rect = tracker bbox (empty if not tracking)
+    ARCHIVE_CROP = 1  // crop of the full frame right before it (tsUs + 1), rect = crop in frame coords
+};
+
+#pragma pack(push, 1)
+struct ArchiveRecord
+{
+    int64_t tsUs;      // wall clock µs since epoch, strictly increasing within the archive
+    uint64_t offset;   // byte offset in the segment data file
+    uint32_t size;     // payload bytes
+    uint16_t kind;     // ArchiveKind
+    uint16_t reserved;
+    int32_t x, y, w, h;
+};
+#pragma pack(pop)
+static_assert(sizeof(ArchiveRecord) == 40, "ArchiveRecord layout is part of the file format");
+
+struct ArchiveConfig
+{
+    std::string dir = "captures/archive";
+    uint64_t maxSegmentBytes = 256ull << 20; // roll to a new segment past this size
+    RetentionManager* retention = nullptr;    // told about every byte written
+};
+
+struct ArchiveStats
+{
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint32_t segments = 0;  // segments opened by this writer
+    uint64_t clampedTs = 0; // timestamps bumped to keep the index monotonic
+    uint64_t failures = 0;
+};
+
+std::string archiveSegmentName(uint32_t seg, const char* ext);
+
+// Thread-safe appender (encoder workers call append concurrently)
+class ArchiveWriter
+{
+public:
+    ArchiveWriter() = default;
+    ~ArchiveWriter();
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    // Continues after the newest existing segment, never rewrites old data
+    bool open(const ArchiveConfig& cfg);
+    void close();
+    bool isOpen() const;
+
+    // Append a full frame JPEG and optionally its crop JPEG as adjacent records.
+    // Returns the timestamp actually stored (after the monotonic clamp) or -1.
+    int64_t append(int64_t tsUs, const cv::Rect& bbox, const std::vector<uchar>& full,
+        const cv::Rect& crop = cv::Rect(), const std::vector<uchar>* cropJpeg = nullptr);
+
+    ArchiveStats stats() const;
+
+private:
+    bool openSegment(uint32_t seg);
+    void closeSegment();
+    bool appendRecord(int64_t tsUs, ArchiveKind kind, const cv::Rect& rect, const std::vector<uchar>& data);
+
+    ArchiveConfig m_cfg;
+    mutable std::mutex m_mtx;
+    FILE* m_data = nullptr;
+    FILE* m_index = nullptr;
+    std::string m_dataPath;
+    std::string m_indexPath;
+    uint32_t m_seg = 0;
+    uint64_t m_dataSize = 0;
+    int64_t m_lastTs = 0;
+    ArchiveStats m_st;
+};
+
+// Read-only view over all segments, index files memory-mapped
+class ArchiveReader
+{
+public:
+    ArchiveReader() = default;
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    bool open(const std::string& dir);
+    void close();
+
+    size_t size() const { return m_total; }
+    const ArchiveRecord& record(size_t i) const;
+    // first record with tsUs >= ts (size() if none), O(log n)
+    size_t seek(int64_t tsUs) const;
+    bool readPayload(size_t i, std::vector<uchar>& out) const;
+
+private:
+    struct Segment
+    {
+        uint32_t seg = 0;
+        std::string dataPath;
+        const ArchiveRecord* records = nullptr;
+        size_t count = 0;
+        size_t first = 0; // global index of records[0]
+        void* mapping = nullptr;
+        size_t mapBytes = 0;
+#if defined(_WIN32)
+        void* file = nullptr;
+        void* map = nullptr;
+#endif
+    };
+    size_t segmentOf(size_t i) const;
+
+    std::vector<Segment> m_segs;
+    size_t m_total = 0;
+};
@@ -0,0 +1,220 @@
+// FrameDiffDetector.cpp
+// Three-frame differencing + running-average background, see FrameDiffDetector.h
+//
+// Per pixel, with c = current luma, p1/p2 = the two previous frames, B = background * 128:
+//   moving = (|c - p1| > T && |c - p2| > T) || |c - (B >> 7)| > Tbg
+//   B += ((c << 7) - B) >> shift        (alpha = 2^-shift, skipped for learningRate 0)
+// B stays within [0, 255 << 7] so all of it fits signed 16-bit lanes.
+//
+
+#include "FrameDiffDetector.h"
+#include <cmath>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SWC_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#else
+#define SWC_X86 0
+#endif
+
+// GCC/Clang only emit AVX2 instructions in functions that ask for them, MSVC always can
+#if SWC_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SWC_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SWC_TARGET_AVX2
+#endif
+
+using namespace std;
+
+namespace
+{
+struct DiffParams
+{
+    uchar diffT;
+    uchar bgT;
+    int shift;
+    bool update;
+};
+
+typedef void (*DiffRowFn)(const uchar* cur, const uchar* p1, const uchar* p2, int16_t* bg, uchar* out,
+                          int x, int n, const DiffParams& p);
+
+void diffRowScalar(const uchar* cur, const uchar* p1, const uchar* p2, int16_t* bg, uchar* out,
+                   int x, int n, const DiffParams& p)
+{
+    for (; x < n; ++x)
+    {
+        int c = cur[x];
+        int b = bg[x] >> 7;
+        bool moving = (abs(c - p1[x]) > p.diffT && abs(c - p2[x]) > p.diffT) || abs(c - b) > p.bgT;
+        out[x] = moving ? 255 : 0;
+        if (p.update) bg[x] = (int16_t)(bg[x] + (((c << 7) - bg[x]) >> p.shift));
+    }
+}
+
+#if SWC_X86
+inline __m128i absDiff8(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+// unsigned a > t, 0xFF / 0x00 per byte
+inline __m128i greater8(__m128i a, __m128i t)
+{
+    return _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(a, t), _mm_setzero_si128()), _mm_set1_epi8(-1));
+}
+
+void diffRowSse2(const uchar* cur, const uchar* p1, const uchar* p2, int16_t* bg, uchar* out,
+                 int x, int n, const DiffParams& p)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vT = _mm_set1_epi8((char)p.diffT);
+    const __m128i vBgT = _mm_set1_epi8((char)p.bgT);
+    const __m128i vShift = _mm_cvtsi32_si128(p.shift);
+    for (; x + 16 <= n; x += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i*)(cur + x));
+        __m128i m1 = greater8(absDiff8(c, _mm_loadu_si128((const __m128i*)(p1 + x))), vT);
+        __m128i m2 = greater8(absDiff8(c, _mm_loadu_si128((const __m128i*)(p2 + x))), vT);
+        __m128i g0 = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i g1 = _mm_loadu_si128((const __m128i*)(bg + x + 8));
+        __m128i b8 = _mm_packus_epi16(_mm_srli_epi16(g0, 7), _mm_srli_epi16(g1, 7));
+        __m128i mb = greater8(absDiff8(c, b8), vBgT);
+        _mm_storeu_si128((__m128i*)(out + x), _mm_or_si128(_mm_and_si128(m1, m2), mb));
+        if (p.update)
+        {
+            __m128i c0 = _mm_slli_epi16(_mm_unpacklo_epi8(c, zero), 7);
+            __m128i c1 = _mm_slli_epi16(_mm_unpackhi_epi8(c, zero), 7);
+            g0 = _mm_add_epi16(g0, _mm_sra_epi16(_mm_sub_epi16(c0, g0), vShift));
+            g1 = _mm_add_epi16(g1, _mm_sra_epi16(_mm_sub_epi16(c1, g1), vShift));
+            _mm_storeu_si128((__m128i*)(bg + x), g0);
+            _mm_storeu_si128((__m128i*)(bg + x + 8), g1);
+        }
+    }
+    diffRowScalar(cur, p1, p2, bg, out, x, n, p);
+}
+
+SWC_TARGET_AVX2 inline __m256i absDiff8x32(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+SWC_TARGET_AVX2 inline __m256i greater8x32(__m256i a, __m256i t)
+{
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(a, t), _mm256_setzero_si256()), _mm256_set1_epi8(-1));
+}
+
+SWC_TARGET_AVX2 void diffRowAvx2(const uchar* cur, const uchar* p1, const uchar* p2, int16_t* bg, uchar* out,
+                                 int x, int n, const DiffParams& p)
+{
+    const __m256i vT = _mm256_set1_epi8((char)p.diffT);
+    const __m256i vBgT = _mm256_set1_epi8((char)p.bgT);
+    const __m128i vShift = _mm_cvtsi32_si128(p.shift);
+    for (; x + 32 <= n; x += 32)
+    {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(cur + x));
+        __m256i m1 = greater8x32(absDiff8x32(c, _mm256_loadu_si256((const __m256i*)(p1 + x))), vT);
+        __m256i m2 = greater8x32(absDiff8x32(c, _mm256_loadu_si256((const __m256i*)(p2 + x))), vT);
+        __m256i g0 = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i g1 = _mm256_loadu_si256((const __m256i*)(bg + x + 16));
+        // packus works per 128-bit lane, the permute restores pixel order
+        __m256i b8 = _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(_mm256_srli_epi16(g0, 7), _mm256_srli_epi16(g1, 7)), 0xD8);
+        __m256i mb = greater8x32(absDiff8x32(c, b8), vBgT);
+        _mm256_storeu_si256((__m256i*)(out + x), _mm256_or_si256(_mm256_and_si256(m1, m2), mb));
+        if (p.update)
+        {
+            __m256i c0 = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(c)), 7);
+            __m256i c1 = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(c, 1)), 7);
+            g0 = _mm256_add_epi16(g0, _mm256_sra_epi16(_mm256_sub_epi16(c0, g0), vShift));
+            g1 = _mm256_add_epi16(g1, _mm256_sra_epi16(_mm256_sub_epi16(c1, g1), vShift));
+            _mm256_storeu_si256((__m256i*)(bg + x), g0);
+            _mm256_storeu_si256((__m256i*)(bg + x + 16), g1);
+        }
+    }
+    diffRowSse2(cur, p1, p2, bg, out, x, n, p);
+}
+#endif
+
+DiffRowFn rowKernel(SimdLevel level)
+{
+#if SWC_X86
+    if (level == SimdLevel::AVX2) return diffRowAvx2;
+    if (level == SimdLevel::SSE2) return diffRowSse2;
+#endif
+    (void)level;
+    return diffRowScalar;
+}
+}
+
+FrameDiffDetector::FrameDiffDetector(const FrameDiffConfig& cfg)
+    : m_cfg(cfg), m_simd(cpuSimdLevel())
+{
+}
+
+void FrameDiffDetector::reset()
+{
+    m_prev1.release();
+    m_prev2.release();
+    m_bg.release();
+}
+
+void FrameDiffDetector::setSimd(SimdLevel level)
+{
+    m_simd = min(level, cpuSimdLevel());
+}
+
+void FrameDiffDetector::apply(const cv::Mat& image, cv::Mat& fgmask, double learningRate)
+{
+    if (image.empty()) return;
+    if (image.channels() == 3) cv::cvtColor(image, m_gray, cv::COLOR_BGR2GRAY);
+    else if (image.channels() == 4) cv::cvtColor(image, m_gray, cv::COLOR_BGRA2GRAY);
+    else image.copyTo(m_gray);
+
+    fgmask.create(m_gray.size(), CV_8UC1);
+    if (m_bg.empty() || m_bg.size() != m_gray.size())
+    {
+        // first frame (or resolution change): seed the model, nothing moves yet
+        m_gray.convertTo(m_bg, CV_16S, 128.0);
+        m_gray.copyTo(m_prev1);
+        m_gray.copyTo(m_prev2);
+        fgmask = cv::Scalar(0);
+        return;
+    }
+
+    if (learningRate < 0) learningRate = m_cfg.defaultLearningRate;
+    DiffParams p;
+    p.diffT = (uchar)min(255, max(0, m_cfg.diffThreshold));
+    p.bgT = (uchar)min(255, max(0, m_cfg.bgThreshold));
+    p.update = learningRate > 0;
+    p.shift = p.update ? min(15, max(0, (int)lround(-log2(min(1.0, learningRate))))) : 0;
+
+    DiffRowFn kernel = rowKernel(m_simd);
+    int rows = m_gray.rows, cols = m_gray.cols;
+    if (m_gray.isContinuous() && m_prev1.isContinuous() && m_prev2.isContinuous() &&
+        m_bg.isContinuous() && fgmask.isContinuous())
+    {
+        cols *= rows;
+        rows = 1;
+    }
+    for (int y = 0; y < rows; ++y)
+    {
+        kernel(m_gray.ptr<uchar>(y), m_prev1.ptr<uchar>(y), m_prev2.ptr<uchar>(y),
+               m_bg.ptr<int16_t>(y), fgmask.ptr<uchar>(y), 0, cols, p);
+    }
+
+    // rotate history buffers without copying: gray -> prev1 -> prev2 -> next gray buffer
+    swap(m_prev2, m_prev1);
+    swap(m_prev1, m_gray);
+}
+
+void FrameDiffDetector::getBackgroundImage(cv::Mat& bg) const
+{
+    if (m_bg.empty())
+    {
+        bg.release();
+        return;
+    }
+    m_bg.convertTo(bg, CV_8U, 1.0 / 128.0);
+}
@@ -0,0 +1,42 @@
+// FrameDiffDetector.h
+// Cheap motion detector for static cameras: three-frame differencing plus a running-average
+// background, on luma. Same contract as cv::BackgroundSubtractor::apply (8-bit mask, 255 = moving,
+// learningRate -1 = default, 0 = frozen background), so the engine can use it in place of MOG2.
+// The per-pixel kernel is hand-vectorized (SSE2 / AVX2, picked at runtime) with a scalar fallback;
+// all three produce bit-identical masks.
+//
+
+#pragma once
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "SwcCommon.h"
+
+struct FrameDiffConfig
+{
+    int diffThreshold = 15;           // |cur - prev| a pixel must exceed in both of the last two frames
+    int bgThreshold = 30;             // |cur - background| that marks a pixel moving on its own
+    double defaultLearningRate = 0.01; // used when apply() gets a negative rate
+};
+
+class FrameDiffDetector
+{
+public:
+    explicit FrameDiffDetector(const FrameDiffConfig& cfg = FrameDiffConfig());
+
+    // image: 8-bit gray, BGR or BGRA. fgmask: CV_8UC1, 0 or 255. The first frame only seeds the model.
+    void apply(const cv::Mat& image, cv::Mat& fgmask, double learningRate = -1);
+    void getBackgroundImage(cv::Mat& bg) const;
+    void reset();
+
+    // Force a kernel (benchmarks), clamped to what the CPU supports
+    void setSimd(SimdLevel level);
+    SimdLevel simd() const { return m_simd; }
+
+private:
+    FrameDiffConfig m_cfg;
+    SimdLevel m_simd;
+    cv::Mat m_gray;
+    cv::Mat m_prev1;  // previous frame
+    cv::Mat m_prev2;  // the one before
+    cv::Mat m_bg;     // CV_16S, background * 128 (7 fractional bits)
+};
@@ -0,0 +1,76 @@
+// FramePool.cpp
+// Pooled frame buffers, see FramePool.h
+//
+
+#include "FramePool.h"
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+struct FramePool::Impl
+{
+    mutable mutex mtx;
+    vector<cv::Mat*> freeList;
+    PoolStats st;
+
+    ~Impl()
+    {
+        for (auto* m : freeList) delete m;
+    }
+
+    void release(cv::Mat* m)
+    {
+        // another cv::Mat header still references the pixels: recycling would overwrite them
+        bool shared = m->u && m->u->refcount > 1;
+        lock_guard<mutex> lk(mtx);
+        --st.inUse;
+        if (shared) ++st.escaped;
+        if (shared || freeList.size() >= st.capacity) 
+        {
+            delete m;
+            return;
+        }
+        freeList.push_back(m);
+    }
+};
+
+FramePool::FramePool(size_t capacity)
+    : m_impl(make_shared<Impl>())
+{
+    m_impl->st.capacity = capacity;
+    for (size_t i = 0; i < capacity; ++i) m_impl->freeList.push_back(new cv::Mat());
+}
+
+void FramePool::preallocate(cv::Size size, int type)
+{
+    lock_guard<mutex> lk(m_impl->mtx);
+    for (auto* m : m_impl->freeList) m->create(size, type);
+}
+
+shared_ptr<cv::Mat> FramePool::acquire()
+{
+    cv::Mat* m = nullptr;
+    {
+        lock_guard<mutex> lk(m_impl->mtx);
+        PoolStats& st = m_impl->st;
+        ++st.acquired;
+        if (!m_impl->freeList.empty()) 
+        {
+            m = m_impl->freeList.back();
+            m_impl->freeList.pop_back();
+            ++st.reused;
+        }
+        else ++st.exhausted;
+        st.peakInUse = max(st.peakInUse, ++st.inUse);
+    }
+    if (!m) m = new cv::Mat();
+    shared_ptr<Impl> impl = m_impl;
+    return shared_ptr<cv::Mat>(m, [impl](cv::Mat* p) { impl->release(p); });
+}
+
+PoolStats FramePool::stats() const
+{
+    lock_guard<mutex> lk(m_impl->mtx);
+    return m_impl->st;
+}
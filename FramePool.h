@@ -0,0 +1,46 @@
+// FramePool.h
+// Preallocated pool of frame buffers handed out as immutable, reference-counted handles (FrameRef).
+// Capture, analysis, preview and the saver share one buffer; copying a FrameRef copies a pointer.
+// When the last FrameRef goes away the buffer returns to the pool, unless a cv::Mat header copy
+// still shares its pixels (then it is left to that owner and counted as escaped).
+//
+
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+// Immutable shared frame, never write through it
+typedef std::shared_ptr<const cv::Mat> FrameRef;
+
+struct PoolStats
+{
+    size_t capacity = 0;     // buffers the pool keeps around
+    size_t inUse = 0;        // buffers currently referenced by handles
+    size_t peakInUse = 0;
+    uint64_t acquired = 0;   // acquire() calls
+    uint64_t reused = 0;     // served from the free list
+    uint64_t exhausted = 0;  // free list empty: a new buffer had to be allocated
+    uint64_t escaped = 0;    // released while a cv::Mat copy still shared the pixels
+};
+
+class FramePool
+{
+public:
+    explicit FramePool(size_t capacity = 8);
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Allocate every free buffer up front for the given frame geometry
+    void preallocate(cv::Size size, int type);
+
+    // Writable buffer for the producer (fill it, then hand it out as FrameRef).
+    // Pooled buffers keep their allocation, cv::VideoCapture::read() reuses it when size/type match.
+    std::shared_ptr<cv::Mat> acquire();
+
+    PoolStats stats() const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> m_impl; // shared with outstanding handles, so they may outlive the pool
+};
@@ -0,0 +1,172 @@
+// FrameRing.h
+// Fixed-capacity lock-free single-producer/single-consumer ring with latest-frame-wins overwrite.
+// The producer never blocks: when every slot holds an unread item the oldest one is replaced.
+// Each slot carries a small state machine (empty/writing/full/reading) so the value itself can be
+// any movable type (cv::Mat, frame handles) without torn reads.
+//
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+struct RingStats
+{
+    uint64_t pushed = 0;      // items accepted by push()
+    uint64_t overwritten = 0; // unread items replaced by the producer (consumer too slow)
+    uint64_t dropped = 0;     // stale items discarded by popLatest()
+    uint64_t popped = 0;      // items handed to the consumer
+};
+
+template <class T>
+class FrameRing
+{
+public:
+    explicit FrameRing(size_t capacity = 4)
+        : m_capacity(capacity < 2 ? 2 : capacity), m_slots(new Slot[m_capacity])
+    {
+    }
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    size_t capacity() const { return m_capacity; }
+
+    // Producer side. Returns false if an unread item had to be overwritten.
+    bool push(T&& v)
+    {
+        for (;;) 
+        {
+            Slot& s = m_slots[m_head % m_capacity];
+            ++m_head;
+            int st = EMPTY;
+            bool overwrite = false;
+            if (!s.state.compare_exchange_strong(st, WRITING, std::memory_order_acquire)) 
+            {
+                // full slot: replace the unread item, reading slot: the consumer owns it, try the next one
+                if (st != FULL || !s.state.compare_exchange_strong(st, WRITING, std::memory_order_acquire)) continue;
+                overwrite = true;
+            }
+            s.value = std::move(v);
+            s.seq.store(++m_seq, std::memory_order_relaxed);
+            s.state.store(FULL, std::memory_order_release);
+            m_pushed.fetch_add(1, std::memory_order_relaxed);
+            if (overwrite) m_overwritten.fetch_add(1, std::memory_order_relaxed);
+            return !overwrite;
+        }
+    }
+
+    // Consumer side: take the newest item and discard anything older
+    bool popLatest(T& out, uint64_t* seqOut = nullptr)
+    {
+        uint64_t seq = 0;
+        if (!take(true, out, seq)) return false;
+        for (size_t i = 0; i < m_capacity; ++i) 
+        {
+            Slot& s = m_slots[i];
+            int st = FULL;
+            if (s.seq.load(std::memory_order_relaxed) < seq &&
+                s.state.compare_exchange_strong(st, READING, std::memory_order_acquire)) 
+            {
+                // re-check under ownership, the producer may have refilled it with a newer item
+                if (s.seq.load(std::memory_order_relaxed) < seq) 
+                {
+                    s.value = T();
+                    s.state.store(EMPTY, std::memory_order_release);
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                else s.state.store(FULL, std::memory_order_release);
+            }
+        }
+        if (seqOut) *seqOut = seq;
+        return true;
+    }
+
+    // Consumer side: take the oldest unread item
+    bool pop(T& out, uint64_t* seqOut = nullptr)
+    {
+        uint64_t seq = 0;
+        if (!take(false, out, seq)) return false;
+        if (seqOut) *seqOut = seq;
+        return true;
+    }
+
+    // Consumer side: discard everything unread
+    void clear()
+    {
+        T tmp;
+        while (pop(tmp)) {}
+    }
+
+    RingStats stats() const
+    {
+        RingStats r;
+        r.pushed = m_pushed.load(std::memory_order_relaxed);
+        r.overwritten = m_overwritten.load(std::memory_order_relaxed);
+        r.dropped = m_dropped.load(std::memory_order_relaxed);
+        r.popped = m_popped.load(std::memory_order_relaxed);
+        return r;
+    }
+
+private:
+    enum { EMPTY = 0, WRITING = 1, FULL = 2, READING = 3 };
+
+    struct Slot
+    {
+        std::atomic<int> state{ EMPTY };
+        std::atomic<uint64_t> seq{ 0 };
+        T value;
+    };
+
+    bool take(bool newest, T& out, uint64_t& seqOut)
+    {
+        for (;;) 
+        {
+            size_t best = m_capacity;
+            uint64_t bestSeq = 0;
+            for (size_t i = 0; i < m_capacity; ++i) 
+            {
+                if (m_slots[i].state.load(std::memory_order_acquire) != FULL) continue;
+                uint64_t sq = m_slots[i].seq.load(std::memory_order_relaxed);
+                if (best == m_capacity || (newest ? sq > bestSeq : sq < bestSeq)) { best = i; bestSeq = sq; }
+            }
+            if (best == m_capacity) return false;
+            Slot& s = m_slots[best];
+            int st = FULL;
+            // lost the race against an overwrite: rescan
+            if (!s.state.compare_exchange_strong(st, READING, std::memory_order_acquire)) continue;
+            uint64_t sq = s.seq.load(std::memory_order_relaxed);
+            if (!newest && sq != bestSeq) 
+            {
+                // overwritten between scan and claim, it is no longer the oldest
+                s.state.store(FULL, std::memory_order_release);
+                continue;
+            }
+            if (sq <= m_lastSeq) 
+            {
+                // straggler that finished writing after a newer item was handed out: keep output monotonic
+                s.value = T();
+                s.state.store(EMPTY, std::memory_order_release);
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            out = std::move(s.value);
+            s.value = T();
+            seqOut = m_lastSeq = sq;
+            s.state.store(EMPTY, std::memory_order_release);
+            m_popped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    const size_t m_capacity;
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_head = 0;   // producer only
+    uint64_t m_seq = 0;  // producer only
+    uint64_t m_lastSeq = 0; // consumer only, last sequence handed out
+    std::atomic<uint64_t> m_pushed{ 0 };
+    std::atomic<uint64_t> m_overwritten{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_popped{ 0 };
+};
@@ -0,0 +1,127 @@
+// HotspotZones.cpp
+// Include / exclude polygon zones, see HotspotZones.h
+//
+
+#include "HotspotZones.h"
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+bool loadZones(const string& path, vector<Zone>& zones)
+{
+    ifstream f(path);
+    if (!f) return false;
+    vector<Zone> out;
+    string line;
+    while (getline(f, line))
+    {
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream ss(line);
+        string kind;
+        int active = 1;
+        if (!(ss >> kind >> active)) continue;
+        Zone z;
+        if (kind == "include") z.kind = ZoneKind::Include;
+        else if (kind == "exclude") z.kind = ZoneKind::Exclude;
+        else continue;
+        z.active = active != 0;
+        float x, y;
+        char comma;
+        while (ss >> x >> comma >> y) z.polygon.push_back(cv::Point2f(x, y));
+        if (z.polygon.size() >= 3) out.push_back(z);
+    }
+    zones = out;
+    return true;
+}
+
+bool saveZones(const string& path, const vector<Zone>& zones)
+{
+    ofstream f(path, ios::trunc);
+    if (!f) return false;
+    f << "# hotspot zones: include|exclude <active 0|1> x,y ... (image pixels)\n";
+    for (const Zone& z : zones)
+    {
+        f << (z.kind == ZoneKind::Include ? "include " : "exclude ") << (z.active ? 1 : 0);
+        for (const cv::Point2f& p : z.polygon) f << ' ' << p.x << ',' << p.y;
+        f << '\n';
+    }
+    return (bool)f;
+}
+
+void ZoneMap::setZones(const vector<Zone>& zones)
+{
+    m_zones.clear();
+    for (const Zone& z : zones)
+    {
+        if (z.polygon.size() >= 3) m_zones.push_back(z);
+    }
+    m_restricted = false;
+    for (const Zone& z : m_zones) m_restricted = m_restricted || z.active;
+    m_dirty = true;
+}
+
+void ZoneMap::prepare(cv::Size fullSize, double scale)
+{
+    if (!m_dirty && fullSize == m_size && scale == m_scale) return;
+    m_dirty = false;
+    m_size = fullSize;
+    m_scale = scale;
+    cv::Size size((int)lround(fullSize.width * scale), (int)lround(fullSize.height * scale));
+    m_roiMask.release();
+    if (!m_restricted)
+    {
+        m_roi = cv::Rect(0, 0, size.width, size.height);
+        m_fullRoi = cv::Rect(0, 0, fullSize.width, fullSize.height);
+        return;
+    }
+
+    vector<vector<cv::Point>> includes, excludes;
+    for (const Zone& z : m_zones)
+    {
+        if (!z.active) continue;
+        vector<cv::Point> poly;
+        for (const cv::Point2f& p : z.polygon) poly.push_back(cv::Point((int)lround(p.x * scale), (int)lround(p.y * scale)));
+        (z.kind == ZoneKind::Include ? includes : excludes).push_back(poly);
+    }
+    cv::Mat mask(size, CV_8UC1, cv::Scalar(includes.empty() ? 255 : 0));
+    if (!includes.empty()) cv::fillPoly(mask, includes, cv::Scalar(255));
+    if (!excludes.empty()) cv::fillPoly(mask, excludes, cv::Scalar(0));
+
+    m_roi = cv::boundingRect(mask);
+    if (m_roi.area() <= 0)
+    {
+        m_roi = m_fullRoi = cv::Rect();
+        return;
+    }
+    double inv = 1.0 / scale;
+    m_fullRoi = cv::Rect(cv::Point((int)floor(m_roi.x * inv), (int)floor(m_roi.y * inv)),
+                         cv::Point((int)ceil((m_roi.x + m_roi.width) * inv), (int)ceil((m_roi.y + m_roi.height) * inv)))
+        & cv::Rect(0, 0, fullSize.width, fullSize.height);
+    cv::Mat roiMask = mask(m_roi);
+    // a rectangular allowed area needs no per-pixel masking
+    if (cv::countNonZero(roiMask) < m_roi.area()) m_roiMask = roiMask.clone();
+}
+
+bool ZoneMap::accepts(const cv::Point2d& p) const
+{
+    if (!m_restricted) return true;
+    bool anyInclude = false, included = false;
+    cv::Point2f pf((float)p.x, (float)p.y);
+    for (const Zone& z : m_zones)
+    {
+        if (!z.active) continue;
+        bool inside = cv::pointPolygonTest(z.polygon, pf, false) >= 0;
+        if (z.kind == ZoneKind::Exclude)
+        {
+            if (inside) return false;
+        }
+        else
+        {
+            anyInclude = true;
+            included = included || inside;
+        }
+    }
+    return !anyInclude || included;
+}
@@ -0,0 +1,58 @@
+// HotspotZones.h
+// Persistent hotspot zones: include / exclude polygons in full-resolution image coords.
+// With no active include zone the whole frame is included; exclude zones always win.
+// The engine rasterizes the allowed area once per frame size / analysis scale and restricts
+// background subtraction, cleanup, contours and HOG to its bounding rect; candidates whose
+// centre falls outside the allowed area are dropped.
+// File format, one zone per line ('#' starts a comment):
+//   include|exclude <active 0|1> x,y x,y x,y ...
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+enum class ZoneKind { Include, Exclude };
+
+struct Zone
+{
+    ZoneKind kind = ZoneKind::Include;
+    bool active = true;
+    std::vector<cv::Point2f> polygon; // image pixels, at least 3 vertices
+};
+
+bool loadZones(const std::string& path, std::vector<Zone>& zones);
+bool saveZones(const std::string& path, const std::vector<Zone>& zones);
+
+class ZoneMap
+{
+public:
+    void setZones(const std::vector<Zone>& zones);
+    const std::vector<Zone>& zones() const { return m_zones; }
+    // true when at least one active zone restricts the frame
+    bool restricted() const { return m_restricted; }
+
+    // Rasterize for a frame size and analysis scale, cached until zones, size or scale change
+    void prepare(cv::Size fullSize, double scale);
+    // Bounding rect of the allowed area in analysis coords (whole frame when unrestricted,
+    // empty when everything is excluded) and the same area in full-resolution coords
+    cv::Rect roi() const { return m_roi; }
+    cv::Rect fullRoi() const { return m_fullRoi; }
+    // Allowed-area mask cropped to roi(), 255 = allowed; empty when the roi is all allowed
+    const cv::Mat& roiMask() const { return m_roiMask; }
+
+    // Full-resolution point inside the allowed area
+    bool accepts(const cv::Point2d& p) const;
+
+private:
+    std::vector<Zone> m_zones;
+    bool m_restricted = false;
+    bool m_dirty = true;
+    cv::Size m_size;
+    double m_scale = 0.0;
+    cv::Rect m_roi;
+    cv::Rect m_fullRoi;
+    cv::Mat m_roiMask;
+};
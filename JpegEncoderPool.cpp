@@ -0,0 +1,162 @@
+// JpegEncoderPool.cpp
+// Async JPEG encode/write workers, see JpegEncoderPool.h
+//
+
+#include "JpegEncoderPool.h"
+#include "SwcCommon.h"
+#include "RetentionManager.h"
+#include <cstdio>
+
+using namespace std;
+
+JpegEncoderPool::~JpegEncoderPool()
+{
+    stop(false);
+}
+
+void JpegEncoderPool::start(const EncoderConfig& cfg)
+{
+    if (running()) return;
+    m_cfg = cfg;
+    m_stopping = false;
+    int n = max(1, cfg.workers);
+    for (int i = 0; i < n; ++i) m_workers.emplace_back(&JpegEncoderPool::workerLoop, this);
+}
+
+void JpegEncoderPool::stop(bool drain)
+{
+    if (!running()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        if (!drain) 
+        {
+            m_st.dropped += m_queue.size();
+            m_queue.clear();
+        }
+        m_stopping = true;
+    }
+    m_haveJob.notify_all();
+    m_haveSpace.notify_all();
+    for (auto& t : m_workers) t.join();
+    m_workers.clear();
+}
+
+bool JpegEncoderPool::submit(EncodeJob&& job)
+{
+    if (!job.frame || job.frame->empty()) return false;
+    unique_lock<mutex> lk(m_mtx);
+    if (m_stopping || m_workers.empty()) return false;
+    ++m_st.submitted;
+    if (m_queue.size() >= m_cfg.maxQueue) 
+    {
+        if (m_cfg.policy == DropPolicy::DropNewest) 
+        {
+            ++m_st.dropped;
+            return false;
+        }
+        if (m_cfg.policy == DropPolicy::DropOldest) 
+        {
+            m_queue.pop_front();
+            ++m_st.dropped;
+        }
+        else 
+        {
+            m_haveSpace.wait(lk, [&] { return m_stopping || m_queue.size() < m_cfg.maxQueue; });
+            if (m_stopping) 
+            {
+                ++m_st.dropped;
+                return false;
+            }
+        }
+    }
+    m_queue.push_back(move(job));
+    m_st.peakQueueDepth = max(m_st.peakQueueDepth, m_queue.size());
+    lk.unlock();
+    m_haveJob.notify_one();
+    return true;
+}
+
+bool JpegEncoderPool::writeFile(const string& path, const vector<uchar>& buf)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    size_t n = fwrite(buf.data(), 1, buf.size(), f);
+    bool ok = (fclose(f) == 0) && n == buf.size();
+    if (ok && m_cfg.retention) m_cfg.retention->add(path, buf.size());
+    return ok;
+}
+
+void JpegEncoderPool::workerLoop()
+{
+    // per-worker encode buffers, imencode keeps their capacity between jobs
+    vector<uchar> buf, cropBuf;
+    const vector<int> params = { cv::IMWRITE_JPEG_QUALITY, m_cfg.quality };
+    for (;;) 
+    {
+        EncodeJob job;
+        {
+            unique_lock<mutex> lk(m_mtx);
+            m_haveJob.wait(lk, [&] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) return; // stopping and drained
+            job = move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_haveSpace.notify_one();
+
+        const cv::Mat& frame = *job.frame;
+        uint64_t files = 0, bytes = 0, failures = 0;
+        double encodeMs = 0.0;
+
+        double t = nowMs();
+        bool fullOk = cv::imencode(".jpg", frame, buf, params);
+        cv::Rect ir = job.crop & cv::Rect(0, 0, frame.cols, frame.rows);
+        bool hasCrop = ir.width > 0 && ir.height > 0;
+        bool cropOk = hasCrop && cv::imencode(".jpg", frame(ir), cropBuf, params);
+        encodeMs = nowMs() - t;
+
+        if (!fullOk) ++failures;
+        else if (m_cfg.archive) 
+        {
+            if (m_cfg.archive->append(job.wallUs, job.bbox, buf, ir, cropOk ? &cropBuf : nullptr) >= 0) 
+            {
+                files += cropOk ? 2 : 1;
+                bytes += buf.size() + (cropOk ? cropBuf.size() : 0);
+            }
+            else ++failures;
+        }
+        else 
+        {
+            if (writeFile(job.basePath + ".jpg", buf)) { ++files; bytes += buf.size(); }
+            else ++failures;
+            string cropPath = job.basePath + (job.trackId > 0 ? "_t" + to_string(job.trackId) : string()) + "_crop.jpg";
+            if (cropOk && writeFile(cropPath, cropBuf)) { ++files; bytes += cropBuf.size(); }
+            else if (cropOk) ++failures;
+        }
+        if (hasCrop && !cropOk) ++failures;
+        if (failures) swcLog("JPEG encoder: encode/write failed for " + (m_cfg.archive ? string("archive record") : job.basePath));
+        double latency = (job.tsMs > 0) ? nowMs() - job.tsMs : 0.0;
+        job.frame.reset(); // hand the buffer back to the pool before taking the lock
+
+        lock_guard<mutex> lk(m_mtx);
+        m_st.filesWritten += files;
+        m_st.bytesWritten += bytes;
+        m_st.failures += failures;
+        m_st.maxEncodeMs = max(m_st.maxEncodeMs, encodeMs);
+        m_encodeMsSum += encodeMs;
+        m_latencyMsSum += latency;
+        ++m_jobsDone;
+    }
+}
+
+EncoderStats JpegEncoderPool::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    EncoderStats s = m_st;
+    s.queueDepth = m_queue.size();
+    if (m_jobsDone) 
+    {
+        s.avgEncodeMs = m_encodeMsSum / m_jobsDone;
+        s.avgLatencyMs = m_latencyMsSum / m_jobsDone;
+    }
+    return s;
+}
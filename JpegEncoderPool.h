@@ -0,0 +1,96 @@
+// JpegEncoderPool.h
+// Bounded multi-threaded JPEG encode/write queue for the save path.
+// Jobs carry a FrameRef (no pixel copy) plus an optional crop rect; workers encode the full frame
+// and the crop in parallel with the GUI and write them to disk, either as loose files or appended to
+// a FrameArchive. Each worker reuses its encode buffers.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "FramePool.h"
+#include "FrameArchive.h"
+
+// What submit() does when the queue is full (disk falling behind)
+enum class DropPolicy
+{
+    DropNewest, // reject the incoming job
+    DropOldest, // evict the oldest queued job, keep the latest
+    Block       // wait for space (never on the UI thread)
+};
+
+struct EncoderConfig
+{
+    int workers = 2;
+    size_t maxQueue = 8;
+    DropPolicy policy = DropPolicy::DropOldest;
+    int quality = 90;
+    ArchiveWriter* archive = nullptr; // set: append to this archive instead of writing loose files
+    RetentionManager* retention = nullptr; // told about loose files (the archive reports its own)
+};
+
+struct EncodeJob
+{
+    FrameRef frame;
+    cv::Rect crop;         // empty = no crop file
+    std::string basePath;  // loose files: basePath + ".jpg" and basePath + "_crop.jpg"
+    int trackId = 0;       // loose crop file is basePath + "_t<id>_crop.jpg" when set (same person, same id)
+    int64_t wallUs = 0;    // archive: record timestamp
+    cv::Rect bbox;         // archive: tracker bbox stored with the full frame
+    double tsMs = 0.0;     // capture time, for latency reporting
+};
+
+struct EncoderStats
+{
+    uint64_t submitted = 0;
+    uint64_t dropped = 0;      // jobs lost to the drop policy
+    uint64_t filesWritten = 0; // loose files or archive records
+    uint64_t failures = 0;     // encode or write errors
+    uint64_t bytesWritten = 0;
+    size_t queueDepth = 0;
+    size_t peakQueueDepth = 0;
+    double avgEncodeMs = 0.0;  // per job (full frame + crop), encode only
+    double maxEncodeMs = 0.0;
+    double avgLatencyMs = 0.0; // capture -> on disk
+};
+
+class JpegEncoderPool
+{
+public:
+    JpegEncoderPool() = default;
+    ~JpegEncoderPool();
+    JpegEncoderPool(const JpegEncoderPool&) = delete;
+    JpegEncoderPool& operator=(const JpegEncoderPool&) = delete;
+
+    void start(const EncoderConfig& cfg = EncoderConfig());
+    // drain = finish queued jobs first, otherwise discard them
+    void stop(bool drain = true);
+    bool running() const { return !m_workers.empty(); }
+
+    // false if the job was rejected (DropNewest with a full queue, or pool not running)
+    bool submit(EncodeJob&& job);
+
+    EncoderStats stats() const;
+
+private:
+    void workerLoop();
+    bool writeFile(const std::string& path, const std::vector<uchar>& buf);
+
+    EncoderConfig m_cfg;
+    std::vector<std::thread> m_workers;
+    mutable std::mutex m_mtx;
+    std::condition_variable m_haveJob;
+    std::condition_variable m_haveSpace;
+    std::deque<EncodeJob> m_queue;
+    bool m_stopping = false;
+    EncoderStats m_st;
+    double m_encodeMsSum = 0.0;
+    double m_latencyMsSum = 0.0;
+    uint64_t m_jobsDone = 0;
+};
@@ -0,0 +1,454 @@
+// MjpegServer.cpp
+// HTTP live view with encode-once fan-out, see MjpegServer.h
+//
+
+#include "MjpegServer.h"
+#include "SwcCommon.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char* kBoundary = "swcframe";
+
+// Sockets are kept as intptr_t in the header (SOCKET is an unsigned pointer-sized handle on Windows,
+// INVALID_SOCKET converts to -1 like the POSIX error value) and cast back here
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+#else
+typedef int SocketHandle;
+#endif
+
+static void closeSocket(intptr_t s)
+{
+    if (s < 0) return;
+#ifdef _WIN32
+    closesocket((SocketHandle)s);
+#else
+    close((SocketHandle)s);
+#endif
+}
+
+static void shutdownSocket(intptr_t s)
+{
+#ifdef _WIN32
+    shutdown((SocketHandle)s, SD_BOTH);
+#else
+    shutdown((SocketHandle)s, SHUT_RDWR);
+#endif
+}
+
+static void setTimeouts(intptr_t s, double sendMs, double recvMs)
+{
+#ifdef _WIN32
+    DWORD snd = (DWORD)sendMs, rcv = (DWORD)recvMs;
+    setsockopt((SocketHandle)s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&snd, sizeof(snd));
+    setsockopt((SocketHandle)s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&rcv, sizeof(rcv));
+#else
+    timeval snd = { (time_t)(sendMs / 1000), (suseconds_t)(fmod(sendMs, 1000.0) * 1000) };
+    timeval rcv = { (time_t)(recvMs / 1000), (suseconds_t)(fmod(recvMs, 1000.0) * 1000) };
+    setsockopt((SocketHandle)s, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+    setsockopt((SocketHandle)s, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+#endif
+}
+
+// Whole buffer or false (peer gone, send timeout); never raises SIGPIPE
+static bool sendAll(intptr_t s, const void* data, size_t len)
+{
+    const char* p = (const char*)data;
+    while (len > 0)
+    {
+#ifdef _WIN32
+        int n = send((SocketHandle)s, p, (int)min(len, (size_t)1 << 20), 0);
+#else
+        ssize_t n = send((SocketHandle)s, p, len, MSG_NOSIGNAL);
+#endif
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool sendText(intptr_t s, const string& text)
+{
+    return sendAll(s, text.data(), text.size());
+}
+
+static void sendStatus(intptr_t s, const char* status)
+{
+    sendText(s, string("HTTP/1.0 ") + status + "\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n" + status + "\n");
+}
+
+MjpegServer::~MjpegServer()
+{
+    stop();
+}
+
+bool MjpegServer::start(const MjpegConfig& cfg)
+{
+    if (m_running || cfg.tiers.empty()) return false;
+    m_cfg = cfg;
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    intptr_t s = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s < 0) return false;
+    int on = 1;
+    setsockopt((SocketHandle)s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)cfg.port);
+    if (inet_pton(AF_INET, cfg.bindAddress.c_str(), &addr.sin_addr) != 1 ||
+        ::bind((SocketHandle)s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen((SocketHandle)s, 16) != 0)
+    {
+        closeSocket(s);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    m_listen = s;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_tiers.assign(cfg.tiers.size(), TierState());
+        m_frame.reset();
+        m_frameSeq = 0;
+        m_st = MjpegStats();
+        m_encodeSum = 0.0;
+    }
+    m_running = true;
+    m_encodeThread = thread(&MjpegServer::encodeLoop, this);
+    m_acceptThread = thread(&MjpegServer::acceptLoop, this);
+    return true;
+}
+
+void MjpegServer::stop()
+{
+    if (!m_running) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_running = false;
+        for (intptr_t s : m_clientSockets) shutdownSocket(s); // unblocks their send / recv
+    }
+    m_haveFrame.notify_all();
+    m_haveJpeg.notify_all();
+    if (m_acceptThread.joinable()) m_acceptThread.join();
+    if (m_encodeThread.joinable()) m_encodeThread.join();
+    closeListener();
+    {
+        unique_lock<mutex> lk(m_mtx);
+        m_clientsDone.wait(lk, [&] { return m_clientThreads == 0; });
+        m_frame.reset();
+        m_tiers.clear();
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void MjpegServer::closeListener()
+{
+    closeSocket(m_listen);
+    m_listen = -1;
+}
+
+void MjpegServer::publish(const FrameRef& frame)
+{
+    if (!m_running || !frame || frame->empty()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_frame = frame;
+        ++m_frameSeq;
+        ++m_st.published;
+    }
+    m_haveFrame.notify_one();
+}
+
+MjpegStats MjpegServer::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_st;
+}
+
+// Polls so stop() needs nothing more than clearing m_running (closing a socket another thread is
+// blocked in accept() on is not portable)
+void MjpegServer::acceptLoop()
+{
+    while (m_running)
+    {
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET((SocketHandle)m_listen, &rd);
+        timeval tv = { 0, 200000 };
+        if (select((int)m_listen + 1, &rd, nullptr, nullptr, &tv) <= 0) continue;
+        intptr_t c = (intptr_t)accept((SocketHandle)m_listen, nullptr, nullptr);
+        if (c < 0) continue;
+        unique_lock<mutex> lk(m_mtx);
+        ++m_st.connections;
+        if (!m_running || m_clientThreads >= m_cfg.maxClients)
+        {
+            ++m_st.rejected;
+            lk.unlock();
+            sendStatus(c, "503 Service Unavailable");
+            closeSocket(c);
+            continue;
+        }
+        ++m_clientThreads;
+        m_clientSockets.push_back(c);
+        lk.unlock();
+        // detached: stop() waits for m_clientThreads to reach 0 instead of joining
+        thread(&MjpegServer::serveClient, this, c).detach();
+    }
+}
+
+// One encode per published frame and tier someone is watching, no faster than maxFps per tier.
+// Buffers are fresh per encode: clients may still be sending the previous one.
+void MjpegServer::encodeLoop()
+{
+    double interval = m_cfg.maxFps > 0 ? 1000.0 / m_cfg.maxFps : 0.0;
+    vector<size_t> todo;
+    vector<size_t> lastBytes(m_cfg.tiers.size(), 0);
+    cv::Mat scaled;
+    unique_lock<mutex> lk(m_mtx);
+    while (m_running)
+    {
+        todo.clear();
+        double now = nowMs(), wait = -1.0;
+        for (size_t i = 0; i < m_tiers.size(); ++i)
+        {
+            const TierState& t = m_tiers[i];
+            if (t.seq == m_frameSeq || (t.viewers == 0 && t.snapshotWaiters == 0)) continue;
+            double due = t.encodedMs + interval - now;
+            if (t.snapshotWaiters > 0 || due <= 0) todo.push_back(i);
+            else if (wait < 0 || due < wait) wait = due;
+        }
+        if (todo.empty())
+        {
+            // nothing due: sleep until a frame or viewer arrives, or the next tier comes due
+            if (wait < 0) m_haveFrame.wait(lk);
+            else m_haveFrame.wait_for(lk, chrono::duration<double, milli>(wait));
+            continue;
+        }
+        FrameRef frame = m_frame;
+        uint64_t seq = m_frameSeq;
+        lk.unlock();
+
+        vector<Jpeg> out(todo.size());
+        for (size_t k = 0; k < todo.size(); ++k)
+        {
+            const MjpegTier& tier = m_cfg.tiers[todo[k]];
+            double t0 = nowMs();
+            const cv::Mat* img = frame.get();
+            if (tier.maxWidth > 0 && img->cols > tier.maxWidth)
+            {
+                int h = max(1, (int)lround(img->rows * double(tier.maxWidth) / img->cols));
+                cv::resize(*img, scaled, cv::Size(tier.maxWidth, h), 0, 0, cv::INTER_AREA);
+                img = &scaled;
+            }
+            auto buf = make_shared<vector<uchar>>();
+            buf->reserve(lastBytes[todo[k]] + lastBytes[todo[k]] / 4);
+            try
+            {
+                cv::imencode(".jpg", *img, *buf, { cv::IMWRITE_JPEG_QUALITY, tier.quality });
+            }
+            catch (const cv::Exception& e)
+            {
+                swcLog(string("MJPEG: encode failed: ") + e.what());
+                buf.reset();
+            }
+            if (buf) lastBytes[todo[k]] = buf->size();
+            out[k] = buf;
+            double ms = nowMs() - t0;
+            lock_guard<mutex> slk(m_mtx);
+            ++m_st.encoded;
+            m_encodeSum += ms;
+            m_st.avgEncodeMs = m_encodeSum / m_st.encoded;
+            m_st.maxEncodeMs = max(m_st.maxEncodeMs, ms);
+        }
+
+        lk.lock();
+        double done = nowMs();
+        for (size_t k = 0; k < todo.size(); ++k)
+        {
+            TierState& t = m_tiers[todo[k]];
+            t.seq = seq; // a failed encode is not retried on the same frame
+            t.encodedMs = done;
+            if (!out[k]) continue;
+            t.jpeg = out[k];
+            ++t.encodes;
+        }
+        m_haveJpeg.notify_all();
+    }
+}
+
+// tier=<name> anywhere in the query string, the first tier if absent or unknown
+size_t MjpegServer::tierIndex(const string& query) const
+{
+    size_t p = query.find("tier=");
+    if (p == string::npos) return 0;
+    string name = query.substr(p + 5, query.find('&', p) == string::npos ? string::npos : query.find('&', p) - p - 5);
+    for (size_t i = 0; i < m_cfg.tiers.size(); ++i)
+    {
+        if (m_cfg.tiers[i].name == name) return i;
+    }
+    return 0;
+}
+
+void MjpegServer::serveClient(intptr_t sock)
+{
+    setTimeouts(sock, m_cfg.sendTimeoutMs, 2000.0);
+    // request line and headers, nothing we serve has a body
+    string req;
+    char buf[1024];
+    while (req.find("\r\n\r\n") == string::npos && req.size() < 8192)
+    {
+        int n = (int)recv((SocketHandle)sock, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        req.append(buf, n);
+    }
+    string method, target;
+    {
+        istringstream line(req.substr(0, req.find("\r\n")));
+        line >> method >> target;
+    }
+    string path = target.substr(0, target.find('?'));
+    string query = target.find('?') == string::npos ? string() : target.substr(target.find('?') + 1);
+    size_t tier = tierIndex(query);
+
+    bool bad = false;
+    if (method != "GET")
+    {
+        sendStatus(sock, target.empty() ? "400 Bad Request" : "405 Method Not Allowed");
+        bad = true;
+    }
+    else if (path == "/stream.mjpg")
+    {
+        streamTier(sock, tier);
+    }
+    else if (path == "/snapshot.jpg")
+    {
+        Jpeg jpeg;
+        if (snapshot(tier, jpeg))
+        {
+            ostringstream h;
+            h << "HTTP/1.0 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: " << jpeg->size()
+              << "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+            if (sendText(sock, h.str()) && sendAll(sock, jpeg->data(), jpeg->size()))
+            {
+                lock_guard<mutex> lk(m_mtx);
+                ++m_st.framesSent;
+                m_st.bytesSent += jpeg->size();
+            }
+        }
+        else
+        {
+            sendStatus(sock, "503 Service Unavailable");
+        }
+    }
+    else if (path == "/" || path == "/index.html")
+    {
+        string body = "<!DOCTYPE html><html><head><title>SecurityWebCam</title></head>"
+                      "<body style=\"margin:0;background:#000\"><img src=\"/stream.mjpg" +
+                      (query.empty() ? string() : "?" + query) + "\" style=\"width:100%\"></body></html>";
+        ostringstream h;
+        h << "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nContent-Length: " << body.size()
+          << "\r\nConnection: close\r\n\r\n" << body;
+        sendText(sock, h.str());
+    }
+    else
+    {
+        sendStatus(sock, "404 Not Found");
+        bad = true;
+    }
+
+    lock_guard<mutex> lk(m_mtx);
+    if (bad) ++m_st.rejected;
+    m_clientSockets.erase(find(m_clientSockets.begin(), m_clientSockets.end(), sock));
+    closeSocket(sock);
+    // last touch of this object: stop() may return (and the server go away) right after
+    --m_clientThreads;
+    m_clientsDone.notify_all();
+}
+
+// Newest encoded frame of the tier each time, whatever this client missed meanwhile is skipped
+void MjpegServer::streamTier(intptr_t sock, size_t tier)
+{
+    ostringstream h;
+    h << "HTTP/1.0 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=" << kBoundary
+      << "\r\nCache-Control: no-cache\r\nPragma: no-cache\r\nConnection: close\r\n\r\n";
+    if (!sendText(sock, h.str())) return;
+
+    {
+        lock_guard<mutex> lk(m_mtx);
+        ++m_tiers[tier].viewers;
+        ++m_st.clients;
+        m_st.peakClients = max(m_st.peakClients, m_st.clients);
+    }
+    m_haveFrame.notify_one(); // the encoder may have been idle without viewers
+
+    uint64_t last = 0;
+    char part[128];
+    for (;;)
+    {
+        Jpeg jpeg;
+        {
+            unique_lock<mutex> lk(m_mtx);
+            const TierState& t = m_tiers[tier];
+            m_haveJpeg.wait(lk, [&] { return !m_running || (t.jpeg && t.encodes != last); });
+            if (!m_running) break;
+            if (last > 0) m_st.framesSkipped += t.encodes - last - 1;
+            last = t.encodes;
+            jpeg = t.jpeg;
+        }
+        int n = snprintf(part, sizeof(part), "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                         kBoundary, jpeg->size());
+        if (!sendAll(sock, part, (size_t)n) || !sendAll(sock, jpeg->data(), jpeg->size()) || !sendAll(sock, "\r\n", 2)) break;
+        lock_guard<mutex> lk(m_mtx);
+        ++m_st.framesSent;
+        m_st.bytesSent += jpeg->size();
+    }
+
+    lock_guard<mutex> lk(m_mtx);
+    --m_tiers[tier].viewers;
+    --m_st.clients;
+}
+
+// The tier's encode of the newest published frame, asking the encoder for one if needed
+// (waits up to a second, e.g. for the first frame after start)
+bool MjpegServer::snapshot(size_t tier, Jpeg& out)
+{
+    unique_lock<mutex> lk(m_mtx);
+    TierState& t = m_tiers[tier];
+    uint64_t want = m_frameSeq;
+    if (!(t.jpeg && t.seq >= want))
+    {
+        ++t.snapshotWaiters;
+        m_haveFrame.notify_one();
+        m_haveJpeg.wait_for(lk, chrono::seconds(1), [&] { return !m_running || (t.jpeg && t.seq >= want); });
+        --t.snapshotWaiters;
+    }
+    out = t.jpeg;
+    return out != nullptr;
+}
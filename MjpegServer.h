@@ -0,0 +1,116 @@
+// MjpegServer.h
+// Embedded live view over HTTP (Linux or Windows sockets, no dependencies beyond OpenCV):
+//   /                 small HTML page showing the stream
+//   /stream.mjpg      multipart/x-mixed-replace MJPEG, ?tier=<name> picks a quality tier
+//   /snapshot.jpg     the newest frame as a single JPEG, same ?tier=
+// publish() only hands the FrameRef to the encoder thread (no copy, no waiting on encodes). That thread
+// encodes each frame once per tier that has viewers, at most maxFps times a second, into a shared
+// immutable buffer every client sends straight from. Each client has its own sender thread that
+// always sends the newest encoded frame: a slow client skips frames instead of queueing them, and
+// nothing it does reaches the capture or analysis side.
+// No authentication: bind to 127.0.0.1 (the default) unless the network is trusted.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "FramePool.h"
+
+struct MjpegTier
+{
+    std::string name;
+    int quality = 80;
+    int maxWidth = 0;  // downscale wider frames to this, 0 = full resolution
+};
+
+struct MjpegConfig
+{
+    int port = 8080;
+    std::string bindAddress = "127.0.0.1";
+    // first tier is the default one
+    std::vector<MjpegTier> tiers = { { "high", 80, 0 }, { "low", 60, 640 } };
+    double maxFps = 15.0;       // encode rate cap per tier, 0 = every published frame
+    int maxClients = 64;
+    double sendTimeoutMs = 5000.0; // a client that accepts nothing for this long is dropped
+};
+
+struct MjpegStats
+{
+    uint64_t published = 0;
+    uint64_t encoded = 0;        // tier encodes, one per frame and tier with viewers
+    uint64_t framesSent = 0;     // summed over clients
+    uint64_t framesSkipped = 0;  // newer frame was ready before a slow client took the previous one
+    uint64_t bytesSent = 0;
+    uint64_t connections = 0;
+    uint64_t rejected = 0;       // over maxClients, bad requests
+    int clients = 0;             // streaming right now
+    int peakClients = 0;
+    double avgEncodeMs = 0.0;
+    double maxEncodeMs = 0.0;
+};
+
+class MjpegServer
+{
+public:
+    MjpegServer() = default;
+    ~MjpegServer();
+    MjpegServer(const MjpegServer&) = delete;
+    MjpegServer& operator=(const MjpegServer&) = delete;
+
+    // false if the port could not be bound
+    bool start(const MjpegConfig& cfg = MjpegConfig());
+    void stop();
+    bool running() const { return m_running; }
+    int port() const { return m_cfg.port; }
+
+    // Newest frame (BGR), shared not copied; cheap enough for the UI thread
+    void publish(const FrameRef& frame);
+
+    MjpegStats stats() const;
+
+private:
+    typedef std::shared_ptr<const std::vector<uchar>> Jpeg;
+
+    struct TierState
+    {
+        Jpeg jpeg;               // newest encoded frame of this tier
+        uint64_t seq = 0;        // published frame it was encoded from
+        double encodedMs = 0.0;
+        uint64_t encodes = 0;    // encodes so far, lets a client count the frames it skipped
+        int viewers = 0;         // streaming clients on this tier
+        int snapshotWaiters = 0;
+    };
+
+    void acceptLoop();
+    void encodeLoop();
+    void serveClient(intptr_t sock);
+    void streamTier(intptr_t sock, size_t tier);
+    bool snapshot(size_t tier, Jpeg& out);
+    size_t tierIndex(const std::string& query) const;
+    void closeListener();
+
+    MjpegConfig m_cfg;
+    std::atomic<bool> m_running{ false };
+    intptr_t m_listen = -1;
+    std::thread m_acceptThread;
+    std::thread m_encodeThread;
+
+    mutable std::mutex m_mtx;
+    std::condition_variable m_haveFrame;  // publish -> encoder
+    std::condition_variable m_haveJpeg;   // encoder -> clients
+    FrameRef m_frame;
+    uint64_t m_frameSeq = 0;
+    std::vector<TierState> m_tiers;
+    std::condition_variable m_clientsDone;
+    int m_clientThreads = 0;                // detached per-client threads still running
+    std::vector<intptr_t> m_clientSockets;  // their sockets, shut down by stop() to unblock them
+    MjpegStats m_st;
+    double m_encodeSum = 0.0;
+};
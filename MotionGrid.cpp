@@ -0,0 +1,117 @@
+// MotionGrid.cpp
+// Tile activity grid, see MotionGrid.h
+//
+
+#include "MotionGrid.h"
+#include <algorithm>
+
+using namespace std;
+
+MotionGrid::MotionGrid(int tileSize, int minPixels)
+{
+    configure(tileSize, minPixels);
+}
+
+void MotionGrid::configure(int tileSize, int minPixels)
+{
+    m_tile = max(4, tileSize);
+    m_minPixels = max(1, minPixels);
+    clear();
+}
+
+void MotionGrid::clear()
+{
+    m_size = cv::Size();
+    m_cols = m_rows = m_dirty = 0;
+    m_counts.clear();
+    m_regions.clear();
+}
+
+void MotionGrid::update(const cv::Mat& mask)
+{
+    if (mask.size() != m_size)
+    {
+        m_size = mask.size();
+        m_cols = (m_size.width + m_tile - 1) / m_tile;
+        m_rows = (m_size.height + m_tile - 1) / m_tile;
+        m_dirtyMask.create(m_rows, m_cols, CV_8UC1);
+    }
+    m_counts.assign((size_t)m_cols * m_rows, 0);
+
+    // one pass over the mask, the inner loop is a plain byte compare-and-add the compiler vectorizes
+    for (int y = 0; y < m_size.height; ++y)
+    {
+        const uchar* p = mask.ptr<uchar>(y);
+        int* c = &m_counts[(size_t)(y / m_tile) * m_cols];
+        for (int tx = 0; tx < m_cols; ++tx)
+        {
+            int x0 = tx * m_tile, x1 = min(x0 + m_tile, m_size.width);
+            int n = 0;
+            for (int x = x0; x < x1; ++x) n += (p[x] != 0);
+            c[tx] += n;
+        }
+    }
+
+    m_dirty = 0;
+    for (int ty = 0; ty < m_rows; ++ty)
+    {
+        uchar* d = m_dirtyMask.ptr<uchar>(ty);
+        for (int tx = 0; tx < m_cols; ++tx)
+        {
+            bool on = dirty(tx, ty);
+            d[tx] = on ? 255 : 0;
+            m_dirty += on;
+        }
+    }
+    buildRegions();
+}
+
+void MotionGrid::buildRegions()
+{
+    m_regions.clear();
+    if (m_dirty == 0) return;
+
+    // grow by one tile so blobs crossing a tile edge keep their neighbours, then one rect per
+    // connected group of tiles
+    cv::Mat grown;
+    cv::dilate(m_dirtyMask, grown, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+    vector<vector<cv::Point>> groups;
+    cv::findContours(grown, groups, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    vector<cv::Rect> tiles;
+    for (auto& g : groups) tiles.push_back(cv::boundingRect(g));
+
+    // bounding rects of separate groups can still overlap (L shapes), merge until disjoint
+    for (bool merged = true; merged; )
+    {
+        merged = false;
+        for (size_t i = 0; i < tiles.size() && !merged; ++i)
+        {
+            for (size_t j = i + 1; j < tiles.size(); ++j)
+            {
+                if ((tiles[i] & tiles[j]).area() > 0)
+                {
+                    tiles[i] |= tiles[j];
+                    tiles.erase(tiles.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    cv::Rect frame(0, 0, m_size.width, m_size.height);
+    for (auto& t : tiles)
+    {
+        cv::Rect r(t.x * m_tile, t.y * m_tile, t.width * m_tile, t.height * m_tile);
+        m_regions.push_back(r & frame);
+    }
+}
+
+double MotionGrid::activity() const
+{
+    return m_counts.empty() ? 0.0 : (double)m_dirty / (double)m_counts.size();
+}
+
+cv::Rect MotionGrid::tileRect(int tx, int ty) const
+{
+    return cv::Rect(tx * m_tile, ty * m_tile, m_tile, m_tile) & cv::Rect(0, 0, m_size.width, m_size.height);
+}
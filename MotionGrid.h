@@ -0,0 +1,49 @@
+// MotionGrid.h
+// Coarse activity grid over a foreground mask: per-tile changed-pixel counts in one pass, the tiles
+// over a threshold are "dirty". Dirty tiles plus their 8 neighbours are merged into a few
+// non-overlapping regions, so the cleanup and contour stages only touch the parts of the frame
+// that changed and are skipped entirely when the grid is quiet.
+// Tile coords and regions are in mask (analysis) pixels.
+//
+
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+class MotionGrid
+{
+public:
+    // tileSize in pixels, minPixels = changed pixels that make a tile dirty
+    explicit MotionGrid(int tileSize = 16, int minPixels = 8);
+    void configure(int tileSize, int minPixels);
+
+    // Count the non-zero pixels of an 8-bit mask per tile and rebuild the regions
+    void update(const cv::Mat& mask);
+    void clear();
+
+    int tileSize() const { return m_tile; }
+    int cols() const { return m_cols; }
+    int rows() const { return m_rows; }
+    int count(int tx, int ty) const { return m_counts[ty * m_cols + tx]; }
+    bool dirty(int tx, int ty) const { return count(tx, ty) >= m_minPixels; }
+    int dirtyCount() const { return m_dirty; }
+    bool quiet() const { return m_dirty == 0; }
+    double activity() const; // dirty tiles / all tiles
+    cv::Rect tileRect(int tx, int ty) const;
+
+    // Tile-aligned, non-overlapping rects covering the dirty tiles and their neighbours
+    const std::vector<cv::Rect>& regions() const { return m_regions; }
+
+private:
+    void buildRegions();
+
+    int m_tile;
+    int m_minPixels;
+    cv::Size m_size;
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_dirty = 0;
+    std::vector<int> m_counts;
+    cv::Mat m_dirtyMask; // one byte per tile
+    std::vector<cv::Rect> m_regions;
+};
@@ -0,0 +1,72 @@
+// PersonDetector.cpp
+// HOG person detector and ROI helper, see PersonDetector.h
+//
+
+#include "PersonDetector.h"
+
+using namespace std;
+
+HogPersonDetector::HogPersonDetector(double scaleStep)
+    : m_scaleStep(scaleStep)
+{
+}
+
+void HogPersonDetector::warmUp()
+{
+    if (!m_init)
+    {
+        m_hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+        m_init = true;
+    }
+    // first detectMultiScale allocates its buffers, pay for it here
+    vector<cv::Rect> found;
+    detect(cv::Mat(256, 128, CV_8UC3, cv::Scalar(0, 0, 0)), found);
+}
+
+void HogPersonDetector::detect(const cv::Mat& image, vector<cv::Rect>& found)
+{
+    found.clear();
+    if (!m_init)
+    {
+        m_hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+        m_init = true;
+    }
+    m_hog.detectMultiScale(image, found, 0, cv::Size(8, 8), cv::Size(32, 32), m_scaleStep, 2);
+}
+
+void PersonDetector::detectBatch(const vector<cv::Mat>& images, vector<vector<cv::Rect>>& found)
+{
+    found.resize(images.size());
+    for (size_t i = 0; i < images.size(); ++i) detect(images[i], found[i]);
+}
+
+cv::Mat roiInput(const PersonDetector& det, const cv::Mat& frame, const cv::Rect& roi, double& scale, cv::Mat& buf)
+{
+    cv::Rect r = roi & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (det.resizesInput()) scale = 1.0;
+    cv::Size minIn = det.minInput();
+    if (r.width * scale < minIn.width || r.height * scale < minIn.height) return cv::Mat();
+    if (scale == 1.0) return frame(r);
+    cv::resize(frame(r), buf, cv::Size(), scale, scale, scale < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    return buf;
+}
+
+void mapFromRoi(const cv::Rect& roi, double scale, vector<cv::Rect>& found)
+{
+    for (auto& d : found)
+    {
+        d = cv::Rect((int)lround(d.x / scale) + roi.x, (int)lround(d.y / scale) + roi.y,
+                     (int)lround(d.width / scale), (int)lround(d.height / scale));
+    }
+}
+
+void detectInRoi(PersonDetector& det, const cv::Mat& frame, const cv::Rect& roi, double scale,
+                 cv::Mat& buf, vector<cv::Rect>& found)
+{
+    found.clear();
+    cv::Rect r = roi & cv::Rect(0, 0, frame.cols, frame.rows);
+    cv::Mat in = roiInput(det, frame, r, scale, buf);
+    if (in.empty()) return;
+    det.detect(in, found);
+    mapFromRoi(r, scale, found);
+}
@@ -0,0 +1,55 @@
+// PersonDetector.h
+// Person detector interface used by the auto-init path, and the HOG implementation
+// (OpenCV default people detector). Detectors are not thread-safe: one instance per thread.
+// DnnPersonDetector (DnnPersonDetector.h) is the cv::dnn alternative.
+//
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+class PersonDetector
+{
+public:
+    virtual ~PersonDetector() {}
+    virtual const char* name() const = 0;
+    // Load models and run one throw-away detection so the first real call has no setup hitch
+    virtual void warmUp() {}
+    // Smallest input that can contain a detection (the detection window)
+    virtual cv::Size minInput() const { return cv::Size(1, 1); }
+    // Detector scales its input to a fixed size itself (no point in pre-scaling a crop)
+    virtual bool resizesInput() const { return false; }
+    // Images worth handing to detectBatch at once
+    virtual int maxBatch() const { return 1; }
+    // Person boxes in image coords
+    virtual void detect(const cv::Mat& image, std::vector<cv::Rect>& found) = 0;
+    // Several images in one go, found[i] belongs to images[i]. Default: one detect() each.
+    virtual void detectBatch(const std::vector<cv::Mat>& images, std::vector<std::vector<cv::Rect>>& found);
+};
+
+class HogPersonDetector : public PersonDetector
+{
+public:
+    explicit HogPersonDetector(double scaleStep = 1.05);
+    const char* name() const override { return "hog"; }
+    void warmUp() override;
+    cv::Size minInput() const override { return cv::Size(64, 128); }
+    void detect(const cv::Mat& image, std::vector<cv::Rect>& found) override;
+
+private:
+    cv::HOGDescriptor m_hog;
+    double m_scaleStep;
+    bool m_init = false;
+};
+
+// Run a detector over roi (full-res coords) resized by scale; boxes come back in full-res coords.
+// Nothing is detected when the scaled roi is smaller than the detector's minimum input.
+// buf is a caller-owned resize buffer.
+void detectInRoi(PersonDetector& det, const cv::Mat& frame, const cv::Rect& roi, double scale,
+                 cv::Mat& buf, std::vector<cv::Rect>& found);
+
+// Detector input for roi resized by scale, empty when it cannot hold a detection. The inverse
+// mapping is mapFromRoi. buf backs the returned Mat when it had to be resized.
+cv::Mat roiInput(const PersonDetector& det, const cv::Mat& frame, const cv::Rect& roi, double& scale, cv::Mat& buf);
+void mapFromRoi(const cv::Rect& roi, double scale, std::vector<cv::Rect>& found);
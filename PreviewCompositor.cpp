@@ -0,0 +1,196 @@
+// PreviewCompositor.cpp
+// Fused letterbox scaler and overlays, see PreviewCompositor.h
+//
+
+#include "PreviewCompositor.h"
+#include "SwcCommon.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const int kWeightBits = 11;
+static const int kWeightOne = 1 << kWeightBits;
+
+void PreviewScene::clear()
+{
+    rects.clear();
+    polylines.clear();
+    selection = cv::Rect();
+}
+
+void PreviewCompositor::attach(void* bits, int w, int h, size_t step)
+{
+    if (!bits || w <= 0 || h <= 0)
+    {
+        m_canvas = cv::Mat();
+        return;
+    }
+    m_canvas = cv::Mat(h, w, CV_8UC4, bits, step);
+}
+
+void PreviewCompositor::resize(int w, int h)
+{
+    if (w <= 0 || h <= 0)
+    {
+        m_canvas = cv::Mat();
+        return;
+    }
+    size_t bytes = (size_t)w * h * 4;
+    bool same = m_canvas.data == m_own.data() && m_canvas.cols == w && m_canvas.rows == h;
+    if (same) return;
+    if (m_own.size() != bytes)
+    {
+        m_own.assign(bytes, 0);
+        ++m_st.reallocations;
+    }
+    m_canvas = cv::Mat(h, w, CV_8UC4, m_own.data());
+}
+
+cv::Point2d PreviewCompositor::toCanvas(const cv::Point2d& p) const
+{
+    return cv::Point2d(m_offset.x + p.x * m_scale, m_offset.y + p.y * m_scale);
+}
+
+// Letterbox placement (same rounding as the UI's screen -> image mapping) and, per output pixel,
+// the two source neighbours along each axis with their fixed-point weights (pixel centres aligned,
+// like cv::resize INTER_LINEAR)
+void PreviewCompositor::buildTables(const cv::Mat& frame)
+{
+    m_src = frame.size();
+    m_srcChannels = frame.channels();
+    m_tableCanvas = m_canvas.size();
+    m_scale = min(double(m_canvas.cols) / frame.cols, double(m_canvas.rows) / frame.rows);
+    m_dst = cv::Size(max(1, min(m_canvas.cols, int(frame.cols * m_scale))), max(1, min(m_canvas.rows, int(frame.rows * m_scale))));
+    m_offset = cv::Point((m_canvas.cols - m_dst.width) / 2, (m_canvas.rows - m_dst.height) / 2);
+
+    auto axis = [&](int dst, int src, int stride, vector<int>& o0, vector<int>& o1, vector<int>& w)
+    {
+        o0.resize(dst);
+        o1.resize(dst);
+        w.resize(dst);
+        double inv = double(src) / dst;
+        for (int i = 0; i < dst; ++i)
+        {
+            double s = max(0.0, (i + 0.5) * inv - 0.5);
+            int a = min((int)s, src - 1);
+            int b = min(a + 1, src - 1);
+            o0[i] = a * stride;
+            o1[i] = b * stride;
+            w[i] = (int)lround((s - a) * kWeightOne);
+        }
+    };
+    axis(m_dst.width, m_src.width, m_srcChannels, m_x0, m_x1, m_wx);
+    axis(m_dst.height, m_src.height, 1, m_y0, m_y1, m_wy);
+    ++m_st.tableBuilds;
+}
+
+// One pass over the output: bilinear sample, BGR (or gray) -> BGRA, written straight to the canvas
+void PreviewCompositor::scaleInto(const cv::Mat& frame)
+{
+    const int cn = m_srcChannels;
+    for (int y = 0; y < m_dst.height; ++y)
+    {
+        const uchar* r0 = frame.ptr<uchar>(m_y0[y]);
+        const uchar* r1 = frame.ptr<uchar>(m_y1[y]);
+        int wy1 = m_wy[y], wy0 = kWeightOne - wy1;
+        uchar* d = m_canvas.ptr<uchar>(m_offset.y + y) + m_offset.x * 4;
+        for (int x = 0; x < m_dst.width; ++x, d += 4)
+        {
+            int a = m_x0[x], b = m_x1[x];
+            int wx1 = m_wx[x], wx0 = kWeightOne - wx1;
+            for (int c = 0; c < 3; ++c)
+            {
+                int k = cn == 1 ? 0 : c;
+                int top = r0[a + k] * wx0 + r0[b + k] * wx1;
+                int bottom = r1[a + k] * wx0 + r1[b + k] * wx1;
+                d[c] = (uchar)((top * wy0 + bottom * wy1 + (1 << (2 * kWeightBits - 1))) >> (2 * kWeightBits));
+            }
+            d[3] = 255;
+        }
+    }
+}
+
+static void dashedLine(cv::Mat& img, cv::Point2d a, cv::Point2d b, const cv::Scalar& color, int thickness)
+{
+    const double dash = 6.0, gap = 4.0;
+    double len = cv::norm(b - a);
+    if (len <= 0.0) return;
+    cv::Point2d dir = (b - a) * (1.0 / len);
+    for (double s = 0.0; s < len; s += dash + gap)
+    {
+        cv::Point2d p = a + dir * s, q = a + dir * min(len, s + dash);
+        cv::line(img, cv::Point((int)lround(p.x), (int)lround(p.y)), cv::Point((int)lround(q.x), (int)lround(q.y)), color, thickness);
+    }
+}
+
+void PreviewCompositor::drawOverlays(const PreviewScene& scene)
+{
+    auto bgra = [](const cv::Scalar& c) { return cv::Scalar(c[0], c[1], c[2], 255); };
+    auto pt = [&](const cv::Point2d& p) { cv::Point2d c = toCanvas(p); return cv::Point((int)lround(c.x), (int)lround(c.y)); };
+
+    for (const PreviewPolyline& pl : scene.polylines)
+    {
+        size_t n = pl.points.size();
+        for (size_t i = 0; i + 1 < n + (pl.closed ? 1 : 0); ++i)
+        {
+            cv::Point2d a = pl.points[i], b = pl.points[(i + 1) % n];
+            if (pl.dashed) dashedLine(m_canvas, toCanvas(a), toCanvas(b), bgra(pl.color), 1);
+            else cv::line(m_canvas, pt(a), pt(b), bgra(pl.color), 1);
+        }
+    }
+    for (const PreviewRect& r : scene.rects)
+    {
+        if (r.rect.empty()) continue;
+        cv::Point tl = pt(r.rect.tl()), br = pt(r.rect.br());
+        if (r.dashed)
+        {
+            cv::Point2d c[4] = { tl, cv::Point2d(br.x, tl.y), br, cv::Point2d(tl.x, br.y) };
+            for (int i = 0; i < 4; ++i) dashedLine(m_canvas, c[i], c[(i + 1) % 4], bgra(r.color), r.thickness);
+        }
+        else
+        {
+            cv::rectangle(m_canvas, tl, br, bgra(r.color), r.thickness);
+        }
+        if (!r.label.empty())
+            cv::putText(m_canvas, r.label, tl + cv::Point(3, 14), cv::FONT_HERSHEY_SIMPLEX, 0.45, bgra(r.color), 1);
+    }
+    if (scene.selection.area() > 0)
+    {
+        const cv::Rect& s = scene.selection;
+        cv::Point2d c[4] = { cv::Point2d(s.x, s.y), cv::Point2d(s.x + s.width, s.y),
+                             cv::Point2d(s.x + s.width, s.y + s.height), cv::Point2d(s.x, s.y + s.height) };
+        for (int i = 0; i < 4; ++i) dashedLine(m_canvas, c[i], c[(i + 1) % 4], cv::Scalar(0, 0, 255, 255), 1);
+    }
+}
+
+void PreviewCompositor::render(const cv::Mat& frame, const PreviewScene& scene)
+{
+    if (m_canvas.empty()) return;
+    double t = nowMs();
+    cv::Scalar bg(scene.background[0], scene.background[1], scene.background[2], 255);
+    if (frame.empty() || frame.depth() != CV_8U || (frame.channels() != 3 && frame.channels() != 1))
+    {
+        m_canvas.setTo(bg);
+    }
+    else
+    {
+        if (frame.size() != m_src || frame.channels() != m_srcChannels || m_canvas.size() != m_tableCanvas) buildTables(frame);
+        // letterbox bars only, the frame area is overwritten in full
+        int w = m_canvas.cols, h = m_canvas.rows;
+        cv::Rect bars[4] = { cv::Rect(0, 0, w, m_offset.y), cv::Rect(0, m_offset.y + m_dst.height, w, h - m_offset.y - m_dst.height),
+                             cv::Rect(0, m_offset.y, m_offset.x, m_dst.height),
+                             cv::Rect(m_offset.x + m_dst.width, m_offset.y, w - m_offset.x - m_dst.width, m_dst.height) };
+        for (const cv::Rect& b : bars)
+        {
+            if (b.area() > 0) m_canvas(b).setTo(bg);
+        }
+        scaleInto(frame);
+        drawOverlays(scene);
+    }
+    double ms = nowMs() - t;
+    ++m_st.renders;
+    m_sumMs += ms;
+    m_st.avgMs = m_sumMs / m_st.renders;
+    m_st.maxMs = max(m_st.maxMs, ms);
+}
@@ -0,0 +1,89 @@
+// PreviewCompositor.h
+// Platform-neutral preview renderer. The frame is letterboxed into a BGRA canvas in one fused pass
+// (bilinear resize and BGR/gray -> BGRA conversion per output pixel, no intermediate images), then
+// the overlays (track boxes with labels, zone polygons, activity tiles, the drag selection) are
+// drawn on top. The canvas is either an internal buffer or memory the caller owns (the UI's DIB
+// section, see attach()); nothing is allocated per render once the canvas and frame sizes are
+// stable, the interpolation tables are rebuilt only when either changes.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+struct PreviewRect
+{
+    cv::Rect2d rect;           // image coords
+    cv::Scalar color;          // BGR
+    int thickness = 1;
+    bool dashed = false;
+    std::string label;         // drawn inside the top-left corner, empty = none
+};
+
+struct PreviewPolyline
+{
+    std::vector<cv::Point2f> points; // image coords
+    cv::Scalar color;
+    bool closed = true;
+    bool dashed = false;
+};
+
+struct PreviewScene
+{
+    cv::Scalar background = cv::Scalar(255, 255, 255); // letterbox bars, BGR
+    std::vector<PreviewRect> rects;
+    std::vector<PreviewPolyline> polylines;
+    cv::Rect selection;        // canvas coords (mouse drag), empty = none
+
+    void clear();
+};
+
+struct PreviewStats
+{
+    uint64_t renders = 0;
+    uint64_t tableBuilds = 0;  // canvas or frame size changed
+    uint64_t reallocations = 0; // internal canvas (re)allocated
+    double avgMs = 0.0;
+    double maxMs = 0.0;
+};
+
+class PreviewCompositor
+{
+public:
+    // Render into caller memory: w x h BGRA pixels, rows step bytes apart (top-down)
+    void attach(void* bits, int w, int h, size_t step);
+    // Render into an internal w x h buffer (kept while the size stays the same)
+    void resize(int w, int h);
+    const cv::Mat& canvas() const { return m_canvas; }
+
+    // Letterboxed frame (CV_8UC3 BGR or CV_8UC1) plus the scene's overlays
+    void render(const cv::Mat& frame, const PreviewScene& scene);
+
+    // Placement of the last frame: canvas = offset + image * scale
+    double scale() const { return m_scale; }
+    cv::Point offset() const { return m_offset; }
+    cv::Point2d toCanvas(const cv::Point2d& p) const;
+
+    const PreviewStats& stats() const { return m_st; }
+
+private:
+    void buildTables(const cv::Mat& frame);
+    void scaleInto(const cv::Mat& frame);
+    void drawOverlays(const PreviewScene& scene);
+
+    cv::Mat m_canvas;          // header over m_own or the attached memory
+    std::vector<uchar> m_own;
+    cv::Size m_src;            // tables are for this frame size ...
+    cv::Size m_dst;            // ... scaled to this one
+    int m_srcChannels = 0;
+    cv::Size m_tableCanvas;
+    double m_scale = 1.0;
+    cv::Point m_offset;
+    // per output column / row: source offsets of the two neighbours and the weight of the second (0..2048)
+    std::vector<int> m_x0, m_x1, m_y0, m_y1;
+    std::vector<int> m_wx, m_wy;
+    PreviewStats m_st;
+    double m_sumMs = 0.0;
+};
@@ -0,0 +1,260 @@
+// RetentionManager.cpp
+// Quota tracking and background pruning, see RetentionManager.h
+//
+
+#include "RetentionManager.h"
+#include "SwcCommon.h"
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+namespace fs = filesystem;
+
+static void lowerThreadPriority()
+{
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+    sched_param sp = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &sp);
+#endif
+}
+
+static int64_t fileWallUs(const fs::path& p)
+{
+    error_code ec;
+    auto ft = fs::last_write_time(p, ec);
+    if (ec) return wallClockUs();
+    auto sys = chrono::system_clock::now() + chrono::duration_cast<chrono::system_clock::duration>(ft - fs::file_time_type::clock::now());
+    return chrono::duration_cast<chrono::microseconds>(sys.time_since_epoch()).count();
+}
+
+RetentionManager::~RetentionManager()
+{
+    stop();
+}
+
+void RetentionManager::start(const RetentionConfig& cfg)
+{
+    if (running()) return;
+    m_cfg = cfg;
+    m_stopping = false;
+    m_kick = false;
+    m_st = RetentionStats();
+    m_files.clear();
+    m_thread = thread(&RetentionManager::run, this);
+}
+
+void RetentionManager::stop()
+{
+    if (!running()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+static string normalPath(const fs::path& p)
+{
+    return p.lexically_normal().generic_string();
+}
+
+// Entry for key, counted once when it is first inserted
+RetentionManager::Entry& RetentionManager::entryLocked(const string& key)
+{
+    auto ins = m_files.emplace(key, Entry());
+    if (ins.second) ++m_st.files;
+    return ins.first->second;
+}
+
+void RetentionManager::add(const string& path, uint64_t bytes)
+{
+    string key = normalPath(path);
+    bool kick = false;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        Entry& e = entryLocked(key);
+        e.bytes += bytes;
+        e.wallUs = wallClockUs();
+        e.lastAddMs = nowMs();
+        m_oldestUs = min(m_oldestUs, e.wallUs);
+        m_st.totalBytes += bytes;
+        kick = !m_kick && m_st.totalBytes > m_cfg.maxBytes;
+        if (kick) m_kick = true;
+    }
+    if (kick) m_cv.notify_one();
+}
+
+void RetentionManager::pin(const string& path)
+{
+    lock_guard<mutex> lk(m_mtx);
+    Entry& e = entryLocked(normalPath(path));
+    if (e.wallUs == 0) 
+    {
+        e.wallUs = wallClockUs();
+        m_oldestUs = min(m_oldestUs, e.wallUs);
+    }
+    e.pinned = true;
+}
+
+void RetentionManager::unpin(const string& path)
+{
+    lock_guard<mutex> lk(m_mtx);
+    auto it = m_files.find(normalPath(path));
+    if (it != m_files.end()) it->second.pinned = false;
+}
+
+void RetentionManager::initialScan()
+{
+    double t0 = nowMs();
+    map<string, Entry> found;
+    error_code ec;
+    for (auto it = fs::recursive_directory_iterator(m_cfg.root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) 
+    {
+        if (!it->is_regular_file(ec)) continue;
+        Entry e;
+        e.bytes = it->file_size(ec);
+        if (ec) { ec.clear(); continue; }
+        e.wallUs = fileWallUs(it->path());
+        found[normalPath(it->path())] = e;
+    }
+    lock_guard<mutex> lk(m_mtx);
+    // merge: files reported by writers while scanning keep their live accounting
+    for (auto& kv : found) 
+    {
+        if (m_files.count(kv.first)) continue;
+        m_files.insert(kv);
+        m_oldestUs = min(m_oldestUs, kv.second.wallUs);
+        m_st.totalBytes += kv.second.bytes;
+        ++m_st.files;
+    }
+    m_st.scanMs = nowMs() - t0;
+}
+
+bool RetentionManager::overQuotaLocked(int64_t nowUs) const
+{
+    if (m_st.totalBytes > m_cfg.maxBytes) return true;
+    if (m_st.freeBytes < m_cfg.minFreeBytes) return true;
+    return m_cfg.maxAgeHours > 0 && m_oldestUs < nowUs - (int64_t)(m_cfg.maxAgeHours * 3600e6);
+}
+
+void RetentionManager::prune()
+{
+    double t0 = nowMs();
+    int64_t nowUs = wallClockUs();
+    int64_t cutoff = (m_cfg.maxAgeHours > 0) ? nowUs - (int64_t)(m_cfg.maxAgeHours * 3600e6) : INT64_MIN;
+    uint64_t target = (uint64_t)(m_cfg.maxBytes * m_cfg.lowWater);
+
+    // oldest first, skipping files that are still being written
+    vector<pair<int64_t, string>> order;
+    uint64_t freeBytes;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        freeBytes = m_st.freeBytes;
+        double now = nowMs();
+        for (auto& kv : m_files) 
+        {
+            if (kv.second.pinned || now - kv.second.lastAddMs < m_cfg.activeGraceMs) continue;
+            order.emplace_back(kv.second.wallUs, kv.first);
+        }
+    }
+    sort(order.begin(), order.end());
+
+    int inBatch = 0;
+    for (auto& o : order) 
+    {
+        uint64_t bytes = 0;
+        {
+            lock_guard<mutex> lk(m_mtx);
+            if (m_stopping) break;
+            bool needBytes = m_st.totalBytes > target;
+            bool needFree = freeBytes < m_cfg.minFreeBytes;
+            bool tooOld = o.first < cutoff;
+            if (!needBytes && !needFree && !tooOld) break;
+            auto it = m_files.find(o.second);
+            if (it == m_files.end() || it->second.pinned) continue; // pinned since the snapshot
+            bytes = it->second.bytes;
+        }
+        error_code ec;
+        fs::path p(o.second);
+        bool removed = fs::remove(p, ec) || !fs::exists(p, ec);
+        {
+            lock_guard<mutex> lk(m_mtx);
+            if (!removed) 
+            {
+                ++m_st.pruneFailures;
+                continue;
+            }
+            auto it = m_files.find(o.second);
+            if (it != m_files.end()) 
+            {
+                m_st.totalBytes -= min(m_st.totalBytes, it->second.bytes);
+                --m_st.files;
+                m_files.erase(it);
+            }
+            ++m_st.prunedFiles;
+            m_st.prunedBytes += bytes;
+        }
+        freeBytes += bytes;
+        // drop directories left empty (event clips), never the root itself
+        fs::path dir = p.parent_path();
+        if (!dir.empty() && fs::path(m_cfg.root) != dir && fs::is_empty(dir, ec)) fs::remove(dir, ec);
+        if (++inBatch >= m_cfg.batchFiles) 
+        {
+            inBatch = 0;
+            this_thread::sleep_for(chrono::milliseconds(20)); // let the save path have the disk
+        }
+    }
+    lock_guard<mutex> lk(m_mtx);
+    m_oldestUs = INT64_MAX;
+    for (auto& kv : m_files) m_oldestUs = min(m_oldestUs, kv.second.wallUs);
+    m_st.lastPruneMs = nowMs() - t0;
+}
+
+void RetentionManager::run()
+{
+    lowerThreadPriority();
+    initialScan();
+    for (;;) 
+    {
+        error_code ec;
+        fs::space_info si = fs::space(m_cfg.root, ec);
+        bool over;
+        {
+            lock_guard<mutex> lk(m_mtx);
+            if (!ec) m_st.freeBytes = si.available;
+            else m_st.freeBytes = UINT64_MAX; // unknown: do not prune on free space
+            over = overQuotaLocked(wallClockUs());
+        }
+        if (over) 
+        {
+            uint64_t before = stats().prunedFiles;
+            prune();
+            RetentionStats s = stats();
+            if (s.prunedFiles != before) swcLog("Retention: pruned to " + to_string(s.totalBytes) + " bytes in " + to_string(s.files)
+                + " files (" + to_string(s.prunedFiles) + " pruned total)");
+        }
+        unique_lock<mutex> lk(m_mtx);
+        m_cv.wait_for(lk, chrono::duration<double, milli>(m_cfg.checkIntervalMs), [&] { return m_stopping || m_kick; });
+        m_kick = false;
+        if (m_stopping) break;
+    }
+}
+
+RetentionStats RetentionManager::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_st;
+}
@@ -0,0 +1,86 @@
+// RetentionManager.h
+// Storage retention for one camera's output directory: byte and age quotas plus a free-space floor.
+// The directory is scanned once at start; after that every writer reports what it wrote (add()),
+// so the total is tracked incrementally and the save path never walks the tree.
+// Pruning deletes the oldest files on a low-priority background thread, in small paced batches.
+// Files a writer has pinned (open archive/video segments) are never pruned, nor are files written
+// within activeGraceMs by writers that do not pin.
+//
+
+#pragma once
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+struct RetentionConfig
+{
+    std::string root = "captures";
+    uint64_t maxBytes = 20ull << 30;        // quota for everything under root
+    double maxAgeHours = 24.0 * 7;          // 0 = no age limit
+    uint64_t minFreeBytes = 1ull << 30;     // keep at least this much free on the volume
+    double lowWater = 0.9;                  // prune down to this fraction of maxBytes
+    double checkIntervalMs = 5000.0;
+    double activeGraceMs = 5 * 60 * 1000.0; // recently written files are considered open
+    int batchFiles = 32;                    // deletes per batch before yielding
+};
+
+struct RetentionStats
+{
+    uint64_t totalBytes = 0;
+    uint64_t files = 0;
+    uint64_t prunedFiles = 0;
+    uint64_t prunedBytes = 0;
+    uint64_t pruneFailures = 0;
+    uint64_t freeBytes = 0;     // volume free space at the last check
+    double scanMs = 0.0;        // initial scan
+    double lastPruneMs = 0.0;   // duration of the last prune pass
+};
+
+class RetentionManager
+{
+public:
+    RetentionManager() = default;
+    ~RetentionManager();
+    RetentionManager(const RetentionManager&) = delete;
+    RetentionManager& operator=(const RetentionManager&) = delete;
+
+    void start(const RetentionConfig& cfg = RetentionConfig());
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+
+    // Writers report bytes appended to (or a new file at) path; cheap, safe from any thread
+    void add(const std::string& path, uint64_t bytes);
+    // A file still being written: registered if new, not pruned until unpinned (closed)
+    void pin(const std::string& path);
+    void unpin(const std::string& path);
+
+    RetentionStats stats() const;
+
+private:
+    struct Entry
+    {
+        uint64_t bytes = 0;
+        int64_t wallUs = 0; // last write, wall clock
+        double lastAddMs = -1e18;
+        bool pinned = false;
+    };
+
+    Entry& entryLocked(const std::string& key);
+    void run();
+    void initialScan();
+    void prune();
+    bool overQuotaLocked(int64_t nowUs) const;
+
+    RetentionConfig m_cfg;
+    std::thread m_thread;
+    mutable std::mutex m_mtx;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+    bool m_kick = false;
+    std::map<std::string, Entry> m_files;
+    int64_t m_oldestUs = INT64_MAX; // writers only add new data, so this moves on scan/prune only
+    RetentionStats m_st;
+};
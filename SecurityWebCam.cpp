@@ -25,18 +25,23 @@
 #pragma comment(lib, "ole32.lib")
 
 #include <opencv2/opencv.hpp>
-#if __has_include(<opencv2/tracking.hpp>)
-#include <opencv2/tracking.hpp>
-#define HAVE_OPENCV_TRACKING 1
-#else
-#define HAVE_OPENCV_TRACKING 0
-#endif
+#include "SwcEngine.h"
+#include "SwcCommon.h"
+#include "CaptureThread.h"
+#include "JpegEncoderPool.h"
+#include "FrameArchive.h"
+#include "EventRecorder.h"
+#include "SegmentRecorder.h"
+#include "RetentionManager.h"
+#include "PreviewCompositor.h"
+#include "MjpegServer.h"
 
 using namespace std;
 namespace fs = filesystem;
 
 static const wchar_t CLASS_NAME[] = L"AutoTrackWin";
-enum { ID_BTN_START = 101, ID_BTN_STOP = 102, ID_CHECK_AUTO = 201, ID_CHECK_SAVE = 202, ID_TIMER_PREVIEW = 301, ID_TIMER_SAVE = 302, ID_COMBO = 303 };
+enum { ID_BTN_START = 101, ID_BTN_STOP = 102, ID_CHECK_AUTO = 201, ID_CHECK_SAVE = 202, ID_CHECK_ZONES = 203, ID_TIMER_PREVIEW = 301, ID_TIMER_SAVE = 302, ID_COMBO = 303 };
+static const UINT WM_APP_FRAME = WM_APP + 1; // capture thread -> UI: a new frame is in the ring
 
 HINSTANCE g_hInst = nullptr;
 HWND g_hwndMain = nullptr;
@@ -44,29 +49,76 @@ HWND g_hCombo = nullptr;
 
 vector<wstring> g_devNames;
 atomic<bool> g_running{ false };
-mutex g_frameMutex;
-cv::Mat g_frame;
-cv::VideoCapture g_cap;
+FrameRef g_frame; // latest analysed frame (shared pool buffer), UI thread only
+double g_frameTs = 0.0; // capture time of g_frame (nowMs)
+CaptureThread g_capture;
+RetentionManager g_retention; // quota + background pruning of g_outDir, outlives the writers that pin files in it
+JpegEncoderPool g_encoder; // save path: encode + write off the UI thread
+ArchiveWriter g_archive;
+EventRecorder g_events; // pre-roll ring, clips on tracker auto-init
+SegmentRecorder g_video; // rolling video segments, used instead of stills when g_saveVideo
+MjpegServer g_http; // remote live view, frames encoded once per quality tier for every viewer
 string g_outDir = "captures";
+bool g_saveArchive = true; // append saves to g_outDir/archive, false = one loose .jpg per save
+bool g_saveVideo = false;  // "Save" records video segments to g_outDir/video instead of stills
+bool g_videoEventGated = true; // video only while tracking (+ post-roll)
 int TimeElapse = 760; // ms
+uint64_t g_quotaBytes = 20ull << 30; // per camera (g_outDir)
+double g_quotaDays = 7.0;
+double g_analysisScale = 1.0; // motion path resolution (0.5 / 0.25 for HD cameras)
+bool g_analysisGray = false;  // motion path on luma only
+MotionBackend g_motionBackend = MotionBackend::MOG2; // FrameDiff is much cheaper for static indoor cameras
+bool g_useTileGrid = true; // skip cleanup/contours/HOG on quiet frames
+bool g_showGrid = false;   // overlay the dirty tiles of the activity grid on the preview
+bool g_asyncDetector = true; // HOG on a worker thread, results forwarded to the current frame
+string g_dnnModel;  // cv::dnn person detector instead of HOG (e.g. MobileNetSSD_deploy.caffemodel), empty = HOG
+string g_dnnConfig; // its .prototxt for Caffe models
+int g_detectInterval = 2;    // detection path every 2 frames, tracker only in between
+int g_detectMaxInterval = 6; // ... stretched to 6 while the scene is calm (motion spikes reset it)
+int g_reverifyFailures = 3;  // drop a track the detector did not confirm 3 times in a row
+int g_maxTracks = 4;         // people followed at once, tracker updates run in parallel
+double g_trackPixelBudget = 96 * 192; // trackers see a frame scaled so each target is about this many px
+TrackerBackend g_tracker = TrackerBackend::CSRT; // preferred tracker backend
+double g_trackerBudgetMs = 25.0; // per-frame tracker time, tracks over their share switch to a cheaper backend
+int g_reacquireFrames = 8;   // after a loss, frames spent scanning around the predicted position before auto-init
+int g_reidGallery = 32;      // lost tracks whose appearance is kept so a returning person keeps their id
+double g_driftSeconds = 30.0; // a track on static pixels this long has locked onto background and is released
+double g_previewFps = 15.0;  // display rate cap, independent of the analysis rate (0 = every analysed frame)
+int g_httpPort = 8080;       // MJPEG live view (http://host:port/), 0 = off; several cameras need their own ports
+string g_httpBind = "127.0.0.1"; // no authentication: "0.0.0.0" only on a trusted network
 
-atomic<bool> g_autoMode{ false };
 atomic<bool> g_saveEnabled{ false };
 
-// Tracking
-cv::Ptr<cv::Tracker> g_tracker;
-atomic<bool> g_tracking{ false };
-cv::Rect2d g_bbox;
+// Analysis: background subtraction auto init + tracking (see SwcEngine.h)
+AnalysisEngine g_engine;
+
+// Hotspot zones: with "Zones" checked, left clicks add polygon vertices, right click closes the
+// polygon as an include zone (Shift + right click: exclude), right click with no vertices removes
+// the last zone. Zones persist in g_outDir/zones.txt.
+bool g_zoneEdit = false;
+vector<cv::Point2f> g_zoneDraft; // image coords
+static string ZonesPath();
+static void ApplyZones(const vector<Zone>& zones);
 
 // Mouse selection
 atomic<bool> g_selecting{ false };
 POINT g_mouseStart = { 0,0 };
 RECT g_previewRect = { 0,0,0,0 };
 cv::Rect g_selectionRect; // integer screen coords while dragging
-
-// Background subtractor for auto init
-cv::Ptr<cv::BackgroundSubtractor> g_backSub;
-double g_minContourArea = 500.0;
+PreviewCompositor g_compositor;
+PreviewScene g_scene;
+HBITMAP g_previewDib = nullptr;
+HBITMAP g_previewOldBmp = nullptr;
+HDC g_previewDC = nullptr;
+cv::Size g_previewSize;
+
+// Frame pacing: the capture thread posts WM_APP_FRAME (at most one queued), every frame is analysed,
+// the preview is repainted at most g_previewFps times a second and only while it can be seen
+atomic<bool> g_framePosted{ false };
+double g_previewLastMs = 0.0;    // last preview render (nowMs)
+bool g_previewPending = false;   // deferred repaint timer armed
+uint64_t g_previewThrottled = 0; // analysed frames folded into a later repaint by the fps cap
+uint64_t g_previewHidden = 0;    // analysed frames not shown, window minimized or covered
 
 // Helpers
 // Logging helper
@@ -82,35 +134,6 @@ static void log(const char* s)
             << " pid=" << GetCurrentProcessId() << " : " << s << "\n";
     }
 }
-string timestampFilename() 
-{
-    auto now = chrono::system_clock::now();
-    time_t t = chrono::system_clock::to_time_t(now);
-    tm tm;
-#if defined(_MSC_VER)
-    localtime_s(&tm, &t);
-#else
-    localtime_r(&t, &tm);
-#endif
-    ostringstream ss;
-    ss << put_time(&tm, "%Y%m%d_%H%M%S");
-    return ss.str();
-}
-
-cv::Ptr<cv::Tracker> makeTracker() 
-{
-#if HAVE_OPENCV_TRACKING
-    try { return cv::TrackerCSRT::create(); }
-    catch (...) {}
-    try { return cv::TrackerKCF::create(); }
-    catch (...) {}
-    return cv::Ptr<cv::Tracker>();
-#else
-    try { return cv::TrackerKCF::create(); }
-    catch (...) { return cv::Ptr<cv::Tracker>(); }
-#endif
-}
-
 // Enumerate video capture devices via DirectShow and return friendly names (Unicode)
 vector<wstring> EnumerateVideoDevices() 
 {
@@ -168,98 +191,203 @@ vector<wstring> EnumerateVideoDevices()
     return result;
 }
 
-HBITMAP MatToHBITMAP(const cv::Mat& mat) 
+// Preview back buffer: a top-down 32 bpp DIB section selected into a memory DC, both kept across
+// paints and recreated only when the preview size changes. The compositor renders straight into it.
+static void ReleasePreviewDib()
 {
-    if (mat.empty()) return nullptr;
-    cv::Mat tmp;
-    if (mat.channels() == 3) cv::cvtColor(mat, tmp, cv::COLOR_BGR2BGRA);
-    else if (mat.channels() == 1) cv::cvtColor(mat, tmp, cv::COLOR_GRAY2BGRA);
-    else tmp = mat;
+    g_compositor.attach(nullptr, 0, 0, 0);
+    if (g_previewDC) 
+    {
+        SelectObject(g_previewDC, g_previewOldBmp);
+        DeleteDC(g_previewDC);
+    }
+    if (g_previewDib) DeleteObject(g_previewDib);
+    g_previewDC = nullptr;
+    g_previewDib = nullptr;
+    g_previewOldBmp = nullptr;
+    g_previewSize = cv::Size();
+}
 
+static bool EnsurePreviewDib(int w, int h)
+{
+    if (g_previewDib && g_previewSize.width == w && g_previewSize.height == h) return true;
+    ReleasePreviewDib();
     BITMAPINFO bmi;
     ZeroMemory(&bmi, sizeof(bmi));
     bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmi.bmiHeader.biWidth = tmp.cols;
-    bmi.bmiHeader.biHeight = -tmp.rows;
+    bmi.bmiHeader.biWidth = w;
+    bmi.bmiHeader.biHeight = -h;
     bmi.bmiHeader.biPlanes = 1;
     bmi.bmiHeader.biBitCount = 32;
     bmi.bmiHeader.biCompression = BI_RGB;
 
     void* bits = nullptr;
-    HDC hdc = GetDC(NULL);
-    HBITMAP hbm = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
-    ReleaseDC(NULL, hdc);
-    if (!hbm || !bits) return nullptr;
-    memcpy(bits, tmp.data, (size_t)tmp.total() * tmp.elemSize());
-    return hbm;
+    g_previewDib = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!g_previewDib || !bits) 
+    {
+        ReleasePreviewDib();
+        return false;
+    }
+    g_previewDC = CreateCompatibleDC(NULL);
+    g_previewOldBmp = (HBITMAP)SelectObject(g_previewDC, g_previewDib);
+    g_previewSize = cv::Size(w, h);
+    g_compositor.attach(bits, w, h, (size_t)w * 4);
+    return true;
 }
 
-void PaintPreview(HDC hdc) 
+// Client area below the control row, where the preview goes
+static RECT PreviewRectOf(HWND hwnd)
 {
     RECT rc;
-    GetClientRect(g_hwndMain, &rc);
+    GetClientRect(hwnd, &rc);
     rc.top = rc.top + 40;
     rc.bottom = rc.bottom - 10;
-    g_previewRect = rc;
-    FillRect(hdc, &rc, (HBRUSH)(COLOR_WINDOW + 1));
-    cv::Mat frameCopy;
+    return rc;
+}
+
+// Minimized, hidden or completely covered by other windows. The clip box test only sees occlusion
+// without desktop composition; composited windows always have one.
+static bool PreviewVisible()
+{
+    if (!IsWindowVisible(g_hwndMain) || IsIconic(g_hwndMain)) return false;
+    HDC hdc = GetDC(g_hwndMain);
+    RECT clip;
+    int region = GetClipBox(hdc, &clip);
+    ReleaseDC(g_hwndMain, hdc);
+    return region != NULLREGION;
+}
+
+// After each analysed frame: repaint now if the last one is old enough, else arm a one-shot timer
+// for when it is (a later frame that finds the repaint due takes over)
+static void SchedulePreview()
+{
+    if (!PreviewVisible()) 
     {
-        lock_guard<mutex> lk(g_frameMutex);
-        if (g_frame.empty()) return;
-        frameCopy = g_frame.clone();
+        ++g_previewHidden;
+        return;
     }
+    double interval = g_previewFps > 0 ? 1000.0 / g_previewFps : 0.0;
+    double wait = g_previewLastMs + interval - nowMs();
+    if (wait <= 0) 
+    {
+        if (g_previewPending) KillTimer(g_hwndMain, ID_TIMER_PREVIEW);
+        g_previewPending = false;
+        InvalidateRect(g_hwndMain, &g_previewRect, FALSE);
+        UpdateWindow(g_hwndMain); // WM_PAINT would otherwise queue behind the next frame's message
+        return;
+    }
+    ++g_previewThrottled;
+    if (g_previewPending) return;
+    g_previewPending = true;
+    SetTimer(g_hwndMain, ID_TIMER_PREVIEW, (UINT)ceil(wait), NULL);
+}
+
+static cv::Scalar ToBgr(COLORREF c)
+{
+    return cv::Scalar(GetBValue(c), GetGValue(c), GetRValue(c));
+}
+
+void PaintPreview(HDC hdc) 
+{
+    RECT rc = PreviewRectOf(g_hwndMain);
+    g_previewRect = rc;
     int pw = rc.right - rc.left;
     int ph = rc.bottom - rc.top;
-    if (pw <= 0 || ph <= 0) return;
-    double fx = double(pw) / frameCopy.cols;
-    double fy = double(ph) / frameCopy.rows;
-    double f = min(fx, fy);
-    int sw = int(frameCopy.cols * f);
-    int sh = int(frameCopy.rows * f);
-    cv::Mat resized;
-    cv::resize(frameCopy, resized, cv::Size(sw, sh));
-    HBITMAP hbm = MatToHBITMAP(resized);
-    if (!hbm) return;
-    HDC memDC = CreateCompatibleDC(hdc);
-    HBITMAP old = (HBITMAP)SelectObject(memDC, hbm);
-    int x = rc.left + (pw - sw) / 2;
-    int y = rc.top + (ph - sh) / 2;
-    BitBlt(hdc, x, y, sw, sh, memDC, 0, 0, SRCCOPY);
-
-    // draw tracker bbox scaled
-    if (g_tracking && !g_bbox.empty()) 
+    FrameRef frameRef = g_frame;
+    if (!frameRef || pw <= 0 || ph <= 0 || !EnsurePreviewDib(pw, ph)) 
     {
-        RECT r;
-        r.left = x + (LONG)round(g_bbox.x * f);
-        r.top = y + (LONG)round(g_bbox.y * f);
-        r.right = x + (LONG)round((g_bbox.x + g_bbox.width) * f);
-        r.bottom = y + (LONG)round((g_bbox.y + g_bbox.height) * f);
-        HPEN pen = CreatePen(PS_SOLID, 2, RGB(0, 255, 0));
-        HGDIOBJ oldPen = SelectObject(hdc, pen);
-        HGDIOBJ oldBrush = SelectObject(hdc, GetStockObject(NULL_BRUSH));
-        Rectangle(hdc, r.left, r.top, r.right, r.bottom);
-        SelectObject(hdc, oldPen);
-        SelectObject(hdc, oldBrush);
-        DeleteObject(pen);
+        FillRect(hdc, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+        return;
     }
 
-    // draw selection rectangle while dragging
-    if (g_selecting) 
+    // the overlays in image coords, the scene's vectors keep their capacity across paints
+    PreviewScene& scene = g_scene;
+    scene.clear();
+    scene.background = ToBgr(GetSysColor(COLOR_WINDOW));
+
+    // tracker bboxes with their ids, the primary track in green
+    for (const Track& tr : g_engine.tracks().tracks()) 
+    {
+        if (tr.bbox.empty()) continue;
+        bool primary = (&tr == g_engine.tracks().primary());
+        PreviewRect r;
+        r.rect = tr.bbox;
+        r.color = ToBgr(primary ? RGB(0, 255, 0) : RGB(255, 200, 0));
+        r.thickness = 2;
+        r.label = "#" + to_string(tr.id);
+        scene.rects.push_back(move(r));
+    }
+
+    // hotspot zones (include blue, exclude red) and the polygon being drawn
+    for (const Zone& z : g_engine.zones()) 
+    {
+        PreviewPolyline pl;
+        pl.points = z.polygon;
+        pl.color = ToBgr(z.kind == ZoneKind::Include ? RGB(0, 160, 255) : RGB(255, 0, 0));
+        pl.dashed = !z.active;
+        scene.polylines.push_back(move(pl));
+    }
+    if (g_zoneEdit && !g_zoneDraft.empty()) 
+    {
+        PreviewPolyline pl;
+        pl.points = g_zoneDraft;
+        pl.color = ToBgr(RGB(255, 255, 255));
+        pl.closed = false;
+        pl.dashed = true;
+        scene.polylines.push_back(move(pl));
+    }
+
+    // activity grid overlay, tiles are in analysis coords relative to the motion ROI
+    const MotionGrid& grid = g_engine.grid();
+    if (g_showGrid && grid.dirtyCount() > 0) 
     {
-        HPEN pen = CreatePen(PS_DASH, 1, RGB(255, 0, 0));
-        HGDIOBJ oldPen = SelectObject(hdc, pen);
-        HGDIOBJ oldBrush = SelectObject(hdc, GetStockObject(NULL_BRUSH));
-        Rectangle(hdc, g_selectionRect.x, g_selectionRect.y,
-            g_selectionRect.x + g_selectionRect.width,
-            g_selectionRect.y + g_selectionRect.height);
-        SelectObject(hdc, oldPen);
-        SelectObject(hdc, oldBrush);
-        DeleteObject(pen);
+        double inv = 1.0 / g_engine.config().analysisScale;
+        cv::Point go = g_engine.motionRoi().tl();
+        for (int ty = 0; ty < grid.rows(); ++ty) 
+        {
+            for (int tx = 0; tx < grid.cols(); ++tx) 
+            {
+                if (!grid.dirty(tx, ty)) continue;
+                cv::Rect t = grid.tileRect(tx, ty);
+                PreviewRect r;
+                r.rect = cv::Rect2d((t.x + go.x) * inv, (t.y + go.y) * inv, t.width * inv, t.height * inv);
+                r.color = ToBgr(RGB(255, 200, 0));
+                scene.rects.push_back(move(r));
+            }
+        }
     }
 
-    SelectObject(memDC, old);
-    DeleteObject(hbm);
-    DeleteDC(memDC);
+    // selection rectangle while dragging, screen coords -> canvas coords
+    if (g_selecting) 
+        scene.selection = g_selectionRect - cv::Point(rc.left, rc.top);
+
+    GdiFlush(); // GDI is done with the DIB before its bits are written
+    g_compositor.render(*frameRef, scene);
+    BitBlt(hdc, rc.left, rc.top, pw, ph, g_previewDC, 0, 0, SRCCOPY);
+    g_previewLastMs = nowMs();
+}
+
+// Newest frame from the capture thread through the engine and recorders, frames that arrived during
+// the last analysis are skipped
+static void AnalyseLatestFrame()
+{
+    TimedFrame tf;
+    if (!g_capture.latest(tf)) return;
+    // share the pool buffer with preview and saver, no copy
+    g_frame = tf.image;
+    g_frameTs = tf.tsMs;
+
+    // auto init + tracker update
+    EngineResult res = g_engine.process(g_frame, g_frameTs);
+
+    // pre-roll ring always runs, a new track opens an event clip
+    g_events.push(g_frame, g_frameTs);
+    if (res.trackerInit) g_events.trigger("auto-init");
+    else if (res.tracking) g_events.extend();
+    if (g_saveEnabled && g_video.running()) g_video.push(g_frame, g_frameTs, res.bbox, res.tracking);
+    g_http.publish(g_frame);
+
+    SchedulePreview();
 }
 
 void StartCamera(int sel) 
@@ -267,16 +395,88 @@ void StartCamera(int sel)
     if (g_running) return;
     try { if (!fs::exists(g_outDir)) fs::create_directories(g_outDir); }
     catch (...) {}
-    if (g_cap.isOpened()) g_cap.release();
-    g_cap.open(sel, cv::CAP_DSHOW);
-    if (!g_cap.isOpened()) 
+    CaptureSource src;
+    src.device = sel;
+    src.api = cv::CAP_DSHOW;
+    // wake the UI thread per frame instead of polling; one message in the queue at a time, the
+    // handler takes the newest frame anyway
+    g_framePosted = false;
+    g_capture.setFrameReady([]()
+    {
+        if (!g_framePosted.exchange(true)) PostMessageW(g_hwndMain, WM_APP_FRAME, 0, 0);
+    });
+    if (!g_capture.start(src)) 
     {
         MessageBoxW(g_hwndMain, L"Failed to open camera.", L"Error", MB_ICONERROR);
         return;
     }
-    g_backSub = cv::createBackgroundSubtractorMOG2(500, 16, true);
+    EngineConfig cfg;
+    cfg.analysisScale = g_analysisScale;
+    cfg.analysisGray = g_analysisGray;
+    cfg.motionBackend = g_motionBackend;
+    cfg.useTileGrid = g_useTileGrid;
+    cfg.asyncDetector = g_asyncDetector;
+    cfg.dnnModel = g_dnnModel;
+    cfg.dnnConfig = g_dnnConfig;
+    cfg.detectInterval = g_detectInterval;
+    cfg.detectMaxInterval = g_detectMaxInterval;
+    cfg.reverifyFailures = g_reverifyFailures;
+    cfg.maxTracks = g_maxTracks;
+    cfg.trackPixelBudget = g_trackPixelBudget;
+    cfg.tracker = g_tracker;
+    cfg.trackerBudgetMs = g_trackerBudgetMs;
+    cfg.reacquireFrames = g_reacquireFrames;
+    cfg.reidGallery = g_reidGallery;
+    cfg.driftSeconds = g_driftSeconds;
+    g_engine.configure(cfg);
+    vector<Zone> zones;
+    if (loadZones(ZonesPath(), zones)) 
+    {
+        g_engine.setZones(zones);
+        log(("Zones: " + to_string(zones.size()) + " loaded from " + ZonesPath()).c_str());
+    }
+    string motionInfo = string("Motion backend: ") + motionBackendName(g_motionBackend);
+    if (g_motionBackend == MotionBackend::FrameDiff) motionInfo += string(" (") + simdName(cpuSimdLevel()) + ")";
+    log(motionInfo.c_str());
+    RetentionConfig qc;
+    qc.root = g_outDir;
+    qc.maxBytes = g_quotaBytes;
+    qc.maxAgeHours = g_quotaDays * 24.0;
+    g_retention.start(qc);
+    EncoderConfig ec;
+    ec.retention = &g_retention;
+    if (g_saveArchive) 
+    {
+        ArchiveConfig ac;
+        ac.dir = g_outDir + "/archive";
+        ac.retention = &g_retention;
+        if (g_archive.open(ac)) ec.archive = &g_archive;
+        else log("Archive: open failed, saving loose files");
+    }
+    g_encoder.start(ec);
+    EventRecorderConfig rc;
+    rc.dir = g_outDir + "/events";
+    rc.retention = &g_retention;
+    g_events.start(rc);
+    if (g_saveVideo) 
+    {
+        SegmentRecorderConfig vc;
+        vc.dir = g_outDir + "/video";
+        vc.eventGated = g_videoEventGated;
+        vc.retention = &g_retention;
+        g_video.start(vc);
+    }
+    if (g_httpPort > 0) 
+    {
+        MjpegConfig hc;
+        hc.port = g_httpPort;
+        hc.bindAddress = g_httpBind;
+        if (g_http.start(hc)) log(("Live view: http://" + g_httpBind + ":" + to_string(g_httpPort) + "/").c_str());
+        else log(("Live view: port " + to_string(g_httpPort) + " unavailable").c_str());
+    }
+    g_previewPending = false;
+    g_previewThrottled = g_previewHidden = 0;
     g_running = true;
-    SetTimer(g_hwndMain, ID_TIMER_PREVIEW, 33, NULL); // ~30fps
     if (g_saveEnabled) SetTimer(g_hwndMain, ID_TIMER_SAVE, TimeElapse, NULL);
 }
 
@@ -285,17 +485,137 @@ void StopCamera()
     if (!g_running) return;
     KillTimer(g_hwndMain, ID_TIMER_PREVIEW);
     KillTimer(g_hwndMain, ID_TIMER_SAVE);
+    g_previewPending = false;
     g_running = false;
-    if (g_cap.isOpened()) g_cap.release();
+    g_capture.stop();
+    if (g_http.running()) 
+    {
+        g_http.stop();
+        MjpegStats hs = g_http.stats();
+        ostringstream sh;
+        sh << "Live view: " << hs.connections << " connections, " << hs.peakClients << " viewers peak, " << hs.encoded
+           << " encodes (" << hs.avgEncodeMs << " ms avg) for " << hs.framesSent << " frames sent, " << hs.framesSkipped
+           << " skipped for slow viewers, " << hs.bytesSent / 1024 << " KiB";
+        log(sh.str().c_str());
+    }
+    CaptureStats cs = g_capture.stats();
+    ostringstream ss;
+    ss << "Capture stopped: " << cs.captured << " grabbed, " << cs.delivered << " analysed, "
+       << cs.overwritten << " overwritten, " << cs.dropped << " dropped, " << cs.readFailures << " read failures; "
+       << "pool peak " << cs.pool.peakInUse << "/" << cs.pool.capacity << ", " << cs.pool.exhausted << " exhausted, "
+       << cs.pool.escaped << " escaped";
+    log(ss.str().c_str());
+    g_frame.reset();
+    g_encoder.stop(true); // finish pending saves
+    EncoderStats es = g_encoder.stats();
+    ostringstream se;
+    se << "Encoder stopped: " << es.filesWritten << " files, " << es.bytesWritten << " bytes, "
+       << es.dropped << " dropped, " << es.failures << " failures, peak queue " << es.peakQueueDepth
+       << ", encode avg " << es.avgEncodeMs << " ms max " << es.maxEncodeMs << " ms, latency avg " << es.avgLatencyMs << " ms";
+    log(se.str().c_str());
+    if (g_archive.isOpen()) 
+    {
+        ArchiveStats as = g_archive.stats();
+        g_archive.close();
+        ostringstream sa;
+        sa << "Archive closed: " << as.records << " records, " << as.bytes << " bytes, " << as.segments
+           << " segments, " << as.clampedTs << " clamped timestamps, " << as.failures << " failures";
+        log(sa.str().c_str());
+    }
+    g_events.stop();
+    EventRecorderStats rs = g_events.stats();
+    ostringstream sr;
+    sr << "Events stopped: " << rs.events << " clips, " << rs.clipFrames << " frames, " << rs.clipBytes << " bytes, "
+       << "pre-roll peak " << rs.peakFootprint << " bytes, encode avg " << rs.avgEncodeMs << " ms, flush max " << rs.maxFlushMs << " ms";
+    log(sr.str().c_str());
+    if (g_video.running()) 
+    {
+        g_video.stop();
+        SegmentRecorderStats vs = g_video.stats();
+        ostringstream sv;
+        sv << "Video stopped: " << vs.codec << ", " << vs.segments << " segments, " << vs.framesWritten << " frames ("
+           << vs.fps << " fps), " << vs.bytesWritten << " bytes (" << vs.bytesPerSec << " B/s), "
+           << vs.framesDropped << " dropped, write avg " << vs.avgWriteMs << " ms";
+        log(sv.str().c_str());
+    }
+    g_retention.stop();
+    RetentionStats qs = g_retention.stats();
+    ostringstream sq;
+    sq << "Retention stopped: " << qs.totalBytes << " bytes in " << qs.files << " files, " << qs.prunedFiles
+       << " pruned (" << qs.prunedBytes << " bytes), " << qs.pruneFailures << " failures, scan " << qs.scanMs << " ms";
+    log(sq.str().c_str());
+    if (g_asyncDetector) 
+    {
+        AsyncDetectorStats ds = g_engine.detectorStats();
+        ostringstream sd;
+        sd << "Detector stopped: " << ds.completed << "/" << ds.submitted << " requests in " << ds.batches
+           << " batches, " << ds.superseded
+           << " superseded, warm-up " << ds.warmUpMs << " ms, detect " << ds.avgDetectMs << " ms avg "
+           << ds.maxDetectMs << " ms max, lag " << ds.avgLagMs << " ms avg " << ds.maxLagMs << " ms max, "
+           << g_engine.staleDetections() << " stale";
+        log(sd.str().c_str());
+    }
+    const CadenceStats& cad = g_engine.scheduler().stats();
+    ostringstream sc;
+    sc << "Cadence: " << cad.detectorFrames << "/" << cad.frames << " detector frames, " << cad.spikes << " motion spikes";
+    log(sc.str().c_str());
+    ostringstream st;
+    st << "Trackers: " << g_engine.tracks().backendSwitches() << " backend switches, " << g_engine.tracks().rescales() << " rescales, "
+       << g_engine.driftReleases() << " drift releases;";
+    for (int i = 0; i < (int)TrackerBackend::Count; ++i) 
     {
-        lock_guard<mutex> lk(g_frameMutex);
-        g_frame.release();
+        TrackerBackendStats ts = g_engine.trackerFactory().stats((TrackerBackend)i);
+        if (ts.samples > 0) st << ' ' << trackerBackendName((TrackerBackend)i) << ' ' << ts.avgUpdateMs << " ms";
     }
-    g_tracking = false;
-    g_tracker.release();
+    log(st.str().c_str());
+    const ReacquireStats& rq = g_engine.reacquireStats();
+    ostringstream sra;
+    sra << "Re-acquisition: " << rq.recovered << "/" << rq.losses << " lost tracks recovered in "
+        << (rq.recovered ? rq.recoverFrames / (double)rq.recovered : 0.0) << " frames avg, " << rq.escalated
+        << " left to auto-init, " << rq.scans << " window scans " << (rq.scans ? rq.scanMs / rq.scans : 0.0) << " ms avg";
+    log(sra.str().c_str());
+    const GalleryStats& gs = g_engine.gallery().stats();
+    ostringstream sg;
+    sg << "Re-identification: " << gs.matches << "/" << gs.queries << " new tracks matched a lost one, " << gs.evicted
+       << " evicted, " << gs.expired << " expired, match " << gs.avgQueryUs << " us avg " << gs.maxQueryUs << " us max";
+    log(sg.str().c_str());
+    const PreviewStats& ps = g_compositor.stats();
+    ostringstream sp;
+    sp << "Preview: " << ps.renders << " renders for " << cs.delivered << " analysed frames (" << g_previewThrottled
+       << " over the fps cap, " << g_previewHidden << " while hidden), " << ps.avgMs << " ms avg " << ps.maxMs
+       << " ms max, " << ps.tableBuilds << " table rebuilds";
+    log(sp.str().c_str());
+    g_engine.shutdown();
+    g_engine.stopTracking();
     InvalidateRect(g_hwndMain, NULL, TRUE);
 }
 
+static string ZonesPath()
+{
+    return g_outDir + "/zones.txt";
+}
+
+static void ApplyZones(const vector<Zone>& zones)
+{
+    g_engine.setZones(zones);
+    error_code ec;
+    fs::create_directories(g_outDir, ec);
+    if (!saveZones(ZonesPath(), zones)) log("Zones: could not write zones.txt");
+}
+
+// Convert a screen point inside the preview to image coords, clamped to the frame
+cv::Point2f ScreenToImagePoint(const cv::Mat& frame, RECT previewRc, POINT p) 
+{
+    int pw = previewRc.right - previewRc.left;
+    int ph = previewRc.bottom - previewRc.top;
+    double f = min(double(pw) / frame.cols, double(ph) / frame.rows);
+    int x = previewRc.left + (pw - int(frame.cols * f)) / 2;
+    int y = previewRc.top + (ph - int(frame.rows * f)) / 2;
+    double ix = min(max((p.x - x) / f, 0.0), double(frame.cols - 1));
+    double iy = min(max((p.y - y) / f, 0.0), double(frame.rows - 1));
+    return cv::Point2f((float)ix, (float)iy);
+}
+
 // Convert screen selection rect to image coords (Rect2d)
 cv::Rect2d ScreenToImageRect(const cv::Mat& frame, RECT previewRc, RECT sel) 
 {
@@ -345,12 +665,17 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
            g_hCombo = CreateWindowW(L"COMBOBOX", NULL,
                 WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL,
                 500, 10, 300, 200, hwnd, (HMENU)ID_COMBO, g_hInst, NULL);
+           HWND hZonesLabel = CreateWindowW(L"STATIC", L"Zones", WS_CHILD | WS_VISIBLE,
+                815, 10, 45, 18, hwnd, NULL, g_hInst, NULL);
+            CreateWindowW(L"BUTTON", NULL, WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+                860, 8, 20, 20, hwnd, (HMENU)ID_CHECK_ZONES, g_hInst, NULL);
 
             SendMessageW(hStartButton, WM_SETFONT, (WPARAM)hFont, TRUE);
             SendMessageW(hStopButton, WM_SETFONT, (WPARAM)hFont, TRUE);
             SendMessageW(hTrackLabel, WM_SETFONT, (WPARAM)hFont, TRUE);
             SendMessageW(hSaveCheck, WM_SETFONT, (WPARAM)hFont, TRUE);
             SendMessageW(g_hCombo, WM_SETFONT, (WPARAM)hFont, TRUE);
+            SendMessageW(hZonesLabel, WM_SETFONT, (WPARAM)hFont, TRUE);
 
             // enumerate devices and fill combo
             g_devNames = EnumerateVideoDevices();
@@ -373,7 +698,13 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             else if (id == ID_BTN_STOP) StopCamera();
             else if (id == ID_CHECK_AUTO) 
             {
-                g_autoMode = (IsDlgButtonChecked(hwnd, ID_CHECK_AUTO) == BST_CHECKED);
+                g_engine.setAutoMode(IsDlgButtonChecked(hwnd, ID_CHECK_AUTO) == BST_CHECKED);
+            }
+            else if (id == ID_CHECK_ZONES) 
+            {
+                g_zoneEdit = (IsDlgButtonChecked(hwnd, ID_CHECK_ZONES) == BST_CHECKED);
+                g_zoneDraft.clear();
+                InvalidateRect(hwnd, NULL, FALSE);
             }
             else if (id == ID_CHECK_SAVE) 
             {
@@ -386,245 +717,44 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             }
             break;
         }
+        case WM_APP_FRAME: 
+            if (g_running) AnalyseLatestFrame();
+            // re-armed after the analysis, not before: a frame pushed meanwhile waits for the next push
+            // instead of queueing another message right away, so a camera faster than the analysis
+            // cannot starve input and paint messages
+            g_framePosted = false;
+            return 0;
         case WM_TIMER: 
         {
-            if (wParam == ID_TIMER_PREVIEW && g_running) 
+            if (wParam == ID_TIMER_PREVIEW) 
             {
-                cv::Mat frame;
-                if (!g_cap.read(frame) || frame.empty()) 
-                {
-                    return 0;
-                }
-                {
-                    lock_guard<mutex> lk(g_frameMutex);
-                    g_frame = frame.clone();
-                }
-
-                // auto init with background subtraction if enabled and not tracking
-                if (g_autoMode && !g_tracking) 
-                {
-                    cv::Mat fg;
-                    // apply background subtractor (tune learning rate if needed)
-                    g_backSub->apply(frame, fg, 0.01); // small learning rate to adapt slowly
-
-                    // morphological cleanup: remove noise and fill holes
-                    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(5, 5));
-                    cv::morphologyEx(fg, fg, cv::MORPH_OPEN, kernel, cv::Point(-1, -1), 1);
-                    cv::morphologyEx(fg, fg, cv::MORPH_CLOSE, kernel, cv::Point(-1, -1), 2);
-                    cv::medianBlur(fg, fg, 5);
-
-                    // find contours
-                    vector<vector<cv::Point>> contours;
-                    cv::findContours(fg, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-
-                    // candidate selection parameters (tune these for your scene)
-                    double minArea = max(g_minContourArea, 500.0); // minimal moving area
-                    double maxAreaRatio = 0.9; // ignore blobs covering almost whole frame
-                    double minAspect = 1.0;    // height/width ratio lower bound for standing person
-                    double maxAspect = 5.0;    // reasonable person aspect upper bound
-                    double minSolidity = 0.4;  // area / convexHull area (people tend to have decent solidity)
-
-                    cv::Rect bestRect;
-                    double bestScore = 0.0;
-
-                    // compute center preference (prefer blobs near previous track or center)
-                    cv::Point2d prefCenter(frame.cols / 2.0, frame.rows / 2.0);
-                    if (g_tracking && !g_bbox.empty()) prefCenter = cv::Point2d(g_bbox.x + g_bbox.width / 2.0, g_bbox.y + g_bbox.height / 2.0);
-
-                    for (auto& c : contours) 
-                    {
-                        double area = cv::contourArea(c);
-                        if (area < minArea) continue;
-
-                        cv::Rect r = cv::boundingRect(c);
-                        double areaRatio = area / (double)(frame.cols * frame.rows);
-                        if (areaRatio > maxAreaRatio) continue;
-
-                        double aspect = (r.height > 0) ? (double)r.height / (double)r.width : 0.0;
-                        if (aspect < minAspect || aspect > maxAspect) continue;
-
-                        // compute solidity
-                        vector<cv::Point> hull;
-                        cv::convexHull(c, hull);
-                        double hullArea = cv::contourArea(hull);
-                        double solidity = (hullArea > 1e-6) ? (area / hullArea) : 0.0;
-                        if (solidity < minSolidity) continue;
-
-                        // scoring: prefer larger area and closeness to preferred center
-                        cv::Point2d cpos(r.x + r.width / 2.0, r.y + r.height / 2.0);
-                        double dist = cv::norm(cpos - prefCenter);
-                        // normalize dist by diag
-                        double diag = sqrt(frame.cols * frame.cols + frame.rows * frame.rows);
-                        double distScore = 1.0 - min(1.0, dist / diag);
-
-                        // score = weighted combination
-                        double score = 0.6 * (area / (double)(frame.cols * frame.rows)) + 0.4 * distScore;
-
-                        // if you have HOG enabled later, you can boost score on HOG overlap
-                        if (score > bestScore) { bestScore = score; bestRect = r; }
-                    }
-
-                    // optional HOG person detector check (only if you want extra validation)
-                    // initialize once (outside this block ideally) to avoid cost each frame:
-                    static cv::HOGDescriptor hog;
-                    static bool hogInit = false;
-                    if (!hogInit) 
-                    {
-                        hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
-                        hogInit = true;
-                    }
-                    bool hogAccepted = false;
-                    cv::Rect hogRect;
-                    if (bestScore <= 0.0) 
-                    {
-                        // if no contour candidate, you can fallback to HOG-only detection
-                        vector<cv::Rect> hogDet;
-                        hog.detectMultiScale(frame, hogDet, 0, cv::Size(8, 8), cv::Size(32, 32), 1.05, 2);
-                        if (!hogDet.empty()) 
-                        {
-                            // pick largest HOG detection near center
-                            double bestA = 0.0;
-                            for (auto& hr : hogDet) 
-                            {
-                                double a = hr.area();
-                                if (a > bestA) { bestA = a; hogRect = hr; }
-                            }
-                            if (bestA > 0) { hogAccepted = true; bestRect = hogRect; bestScore = 0.5; }
-                        }
-                    }
-                    else 
-                    {
-                        // if we have a contour candidate, check overlap with HOG detection to boost confidence
-                        vector<cv::Rect> hogDet;
-                        hog.detectMultiScale(frame, hogDet, 0, cv::Size(8, 8), cv::Size(32, 32), 1.05, 2);
-                        for (auto& hr : hogDet) 
-                        {
-                            double iou = 0.0;
-                            cv::Rect inter = bestRect & hr;
-                            if (inter.area() > 0) 
-                            {
-                                double uni = (double)(bestRect.area() + hr.area() - inter.area());
-                                iou = inter.area() / uni;
-                            }
-                            if (iou > 0.2) { bestScore += 0.3; break; } // boost if some overlap
-                        }
-                    }
-                    // If we found a viable candidate, init tracker
-                    if (bestScore > 0.0 && bestRect.area() > 0) 
-                    {
-                        cv::Rect2d r2d(bestRect.x, bestRect.y, bestRect.width, bestRect.height);
-                        // clamp
-                        r2d.x = max(0.0, r2d.x);
-                        r2d.y = max(0.0, r2d.y);
-                        r2d.width = min(r2d.width, (double)frame.cols - r2d.x);
-                        r2d.height = min(r2d.height, (double)frame.rows - r2d.y);
-
-                        auto t = makeTracker();
-                        if (t) 
-                        {
-                            bool initOk = false;
-                            try { initOk = true; t->init(frame, r2d); }
-                            catch (...) { initOk = false; }
-                            if (initOk) 
-                            {
-                                g_tracker = t;
-                                g_bbox = r2d;
-                                g_tracking = true;
-                                log("Auto-init: tracker initialized (contour/HOG)");
-                            }
-                            else 
-                            {
-                                t.release();
-                                log("Auto-init: tracker init failed");
-                            }
-                        }
-                    } // end auto-init
-                }
-                // update tracker if running
-                if (g_tracking && g_tracker) 
-                {
-                    // call update using integer rect (matches your tracking.hpp)
-                    cv::Rect bboxInt;
-                    bool ok = false;
-                    try 
-                    {
-                        ok = g_tracker->update(frame, bboxInt);
-                    }
-                    catch (...) {
-                        ok = false;
-                    }
-                    if (!ok) 
-                    {
-                        // lost tracker
-                        g_tracking = false;
-                        g_tracker.release();
-                        log("Tracker update failed -> released");
-                    }
-                    else 
-                    {
-                        // convert to double-precision internal bbox
-                        cv::Rect2d newbbox((double)bboxInt.x, (double)bboxInt.y,
-                            (double)bboxInt.width, (double)bboxInt.height);
-
-                        // clamp to image bounds
-                        newbbox.x = max(0.0, newbbox.x);
-                        newbbox.y = max(0.0, newbbox.y);
-                        newbbox.width = max(0.0, min(newbbox.width, double(frame.cols) - newbbox.x));
-                        newbbox.height = max(0.0, min(newbbox.height, double(frame.rows) - newbbox.y));
-
-                        // sanity checks
-                        double area = newbbox.width * newbbox.height;
-                        double frameA = double(frame.cols) * double(frame.rows);
-                        const double MAX_AREA_RATIO = 0.95;
-                        const double MIN_AREA = 16.0;
-
-                        if (newbbox.width <= 1.0 || newbbox.height <= 1.0 ||
-                            area < MIN_AREA || area > MAX_AREA_RATIO * frameA) 
-                        {
-                            g_tracking = false;
-                            g_tracker.release();
-                            log("Tracker produced invalid bbox -> lost");
-                        }
-                        else 
-                        {
-                            g_bbox = newbbox;
-                        }
-                    }
-                }
-
-                InvalidateRect(g_hwndMain ? g_hwndMain : hwnd, NULL, FALSE);
+                // deferred repaint of the newest analysed frame, one-shot
+                KillTimer(hwnd, ID_TIMER_PREVIEW);
+                g_previewPending = false;
+                if (g_running && PreviewVisible()) InvalidateRect(hwnd, &g_previewRect, FALSE);
                 return 0;
             }
-            else if (wParam == ID_TIMER_SAVE && g_running && g_saveEnabled) 
+            else if (wParam == ID_TIMER_SAVE && g_running && g_saveEnabled && !g_saveVideo) 
             {
-                // save current frame and cropped object if tracked
-                cv::Mat frameCopy;
+                // queue current frame and cropped object if tracked, workers encode and write
+                if (!g_frame)
                 {
-                    lock_guard<mutex> lk(g_frameMutex);
-                    if (g_frame.empty())
-                    {
-                        return 0;
-                    }
-                    frameCopy = g_frame.clone();
+                    return 0;
                 }
-
-                string base = g_outDir + "/" + timestampFilename();
-                string fullfn = base + ".jpg";
-                cv::imwrite(fullfn, frameCopy);
-                if (g_tracking && !g_bbox.empty()) 
+                EncodeJob job;
+                job.frame = g_frame;
+                job.tsMs = g_frameTs;
+                job.wallUs = steadyToWallUs(g_frameTs);
+                job.basePath = g_outDir + "/" + timestampFilename();
+                cv::Rect2d bbox = g_engine.bbox();
+                if (g_engine.tracking() && !bbox.empty()) 
                 {
-                    cv::Rect ir((int)round(g_bbox.x), (int)round(g_bbox.y),
-                        (int)round(g_bbox.width), (int)round(g_bbox.height));
-                    ir &= cv::Rect(0, 0, frameCopy.cols, frameCopy.rows);
-                    if (ir.width > 0 && ir.height > 0) 
-                    {
-                        cv::Mat crop = frameCopy(ir).clone();
-                        string cropfn = base + "_crop.jpg";
-                        cv::imwrite(cropfn, crop);
-                    }
+                    job.crop = cv::Rect((int)round(bbox.x), (int)round(bbox.y),
+                        (int)round(bbox.width), (int)round(bbox.height));
+                    job.bbox = job.crop;
+                    if (const Track* p = g_engine.tracks().primary()) job.trackId = p->id;
                 }
-
-                InvalidateRect(g_hwndMain ? g_hwndMain : hwnd, NULL, FALSE);
+                if (!g_encoder.submit(move(job))) log("Save: encoder queue full, frame dropped");
                 return 0;
             }
             break;
@@ -635,6 +765,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             if (p.x >= g_previewRect.left && p.x <= g_previewRect.right &&
                 p.y >= g_previewRect.top && p.y <= g_previewRect.bottom) 
             {
+                if (g_zoneEdit) 
+                {
+                    FrameRef frameRef = g_frame;
+                    if (!frameRef) break;
+                    g_zoneDraft.push_back(ScreenToImagePoint(*frameRef, g_previewRect, p));
+                    InvalidateRect(hwnd, NULL, FALSE);
+                    break;
+                }
                 g_selecting = true;
                 g_mouseStart = p;
                 g_selectionRect = cv::Rect(p.x, p.y, 0, 0);
@@ -666,43 +804,56 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 ReleaseCapture();
                 g_selecting = false;
                 // convert to image coords and init tracker
-                cv::Mat frameCopy;
-                {
-                    lock_guard<mutex> lk(g_frameMutex);
-                    if (g_frame.empty()) break;
-                    frameCopy = g_frame.clone();
-                }
-                cv::Rect2d r2d = ScreenToImageRect(frameCopy, g_previewRect, sel);
+                FrameRef frameRef = g_frame;
+                if (!frameRef) break;
+                const cv::Mat& frame = *frameRef;
+                cv::Rect2d r2d = ScreenToImageRect(frame, g_previewRect, sel);
                 if (r2d.width > 5 && r2d.height > 5) 
                 {
-                    auto t = makeTracker();
-                    if (!t) break;
-                    // clamp
-                    r2d.x = max(0.0, r2d.x); r2d.y = max(0.0, r2d.y);
-                    r2d.width = min(r2d.width, double(frameCopy.cols) - r2d.x);
-                    r2d.height = min(r2d.height, double(frameCopy.rows) - r2d.y);
-                    bool ok = true;//TODO check init return
-                        t->init(frameCopy, r2d);
-                    if (ok) 
-                    {
-                        g_tracker = t;
-                        g_bbox = r2d;
-                        g_tracking = true;
-                    }
-                    else 
-                    {
-                        t.release();
-                    }
+                    if (!g_engine.startTracking(frame, r2d)) log("Manual select: tracker init failed");
                     InvalidateRect(hwnd, NULL, FALSE);
                 }
             }
             break;
         }
+        case WM_RBUTTONUP: 
+        {
+            if (!g_zoneEdit) break;
+            vector<Zone> zones = g_engine.zones();
+            if (g_zoneDraft.size() >= 3) 
+            {
+                Zone z;
+                z.kind = (wParam & MK_SHIFT) ? ZoneKind::Exclude : ZoneKind::Include;
+                z.polygon = g_zoneDraft;
+                zones.push_back(z);
+                ApplyZones(zones);
+            }
+            else if (g_zoneDraft.empty() && !zones.empty()) 
+            {
+                zones.pop_back();
+                ApplyZones(zones);
+            }
+            g_zoneDraft.clear();
+            InvalidateRect(hwnd, NULL, FALSE);
+            break;
+        }
+        case WM_ERASEBKGND: 
+        {
+            // the preview covers its own rect (frame, letterbox bars or a fill), erase only around it
+            HDC hdc = (HDC)wParam;
+            RECT rc, prc = PreviewRectOf(hwnd);
+            GetClientRect(hwnd, &rc);
+            ExcludeClipRect(hdc, prc.left, prc.top, prc.right, prc.bottom);
+            FillRect(hdc, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+            return 1;
+        }
         case WM_PAINT: 
         {
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(hwnd, &ps);
-            PaintPreview(hdc);
+            // controls-only repaints leave the preview alone
+            RECT prc = PreviewRectOf(hwnd), hit;
+            if (IntersectRect(&hit, &ps.rcPaint, &prc)) PaintPreview(hdc);
             EndPaint(hwnd, &ps);
             break;
         }
@@ -711,6 +862,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             break;
         case WM_DESTROY:
             StopCamera();
+            ReleasePreviewDib();
             PostQuitMessage(0);
             break;
         default:
@@ -722,6 +874,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) 
 {
     g_hInst = hInstance;
+    setLogSink(log);
     WNDCLASSW wc = {};
     wc.lpfnWndProc = WndProc;
     wc.hInstance = hInstance;
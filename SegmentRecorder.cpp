@@ -0,0 +1,197 @@
+// SegmentRecorder.cpp
+// Rolling VideoWriter segments with a bbox sidecar, see SegmentRecorder.h
+//
+
+#include "SegmentRecorder.h"
+#include "SwcCommon.h"
+#include "RetentionManager.h"
+#include <filesystem>
+#include <chrono>
+
+using namespace std;
+namespace fs = filesystem;
+
+SegmentRecorder::~SegmentRecorder()
+{
+    stop();
+}
+
+void SegmentRecorder::start(const SegmentRecorderConfig& cfg)
+{
+    if (running()) return;
+    m_cfg = cfg;
+    m_stopping = false;
+    m_st = SegmentRecorderStats();
+    m_writeMsSum = 0.0;
+    m_lastAcceptedTs = -1e18;
+    m_gateUntil = -1e18;
+    m_startMs = nowMs();
+    error_code ec;
+    fs::create_directories(m_cfg.dir, ec);
+    m_thread = thread(&SegmentRecorder::run, this);
+}
+
+void SegmentRecorder::stop()
+{
+    if (!running()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void SegmentRecorder::push(const FrameRef& frame, double tsMs, const cv::Rect2d& bbox, bool active)
+{
+    if (!frame || frame->empty()) return;
+    {
+        lock_guard<mutex> lk(m_mtx);
+        if (m_stopping) return;
+        if (active) m_gateUntil = tsMs + m_cfg.postRollMs;
+        if (m_cfg.eventGated && tsMs > m_gateUntil) return;
+        // decimate to the recording rate (10% slack against capture jitter)
+        if (tsMs - m_lastAcceptedTs < 0.9 * 1000.0 / m_cfg.fps) return;
+        m_lastAcceptedTs = tsMs;
+        if (m_queue.size() >= m_cfg.maxQueue) 
+        {
+            m_queue.pop_front();
+            ++m_st.framesDropped;
+        }
+        Item it;
+        it.frame = frame;
+        it.tsMs = tsMs;
+        it.bbox = bbox;
+        it.tracking = active;
+        m_queue.push_back(move(it));
+    }
+    m_cv.notify_one();
+}
+
+bool SegmentRecorder::openSegment(const cv::Size& size)
+{
+    string base = m_cfg.dir + "/" + timestampFilename();
+    // once a codec worked keep using it, otherwise probe the list
+    vector<string> codecs = m_codec.empty() ? m_cfg.codecs : vector<string>{ m_codec };
+    for (auto& c : codecs) 
+    {
+        if (c.size() != 4) continue;
+        string ext = (c == "MJPG" || c == "XVID") ? ".avi" : ".mp4";
+        int fourcc = cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]);
+        try 
+        {
+            if (!m_writer.open(base + ext, fourcc, m_cfg.fps, size, true)) continue;
+        }
+        catch (...) { continue; }
+        if (m_codec != c) swcLog("Video: recording with " + c + " (" + m_writer.getBackendName() + ")");
+        m_codec = c;
+        m_segPath = base + ext;
+        m_sidePath = base + ".csv";
+        m_sidecar.open(m_sidePath);
+        m_sidecar << "frame,wall_us,tracking,x,y,w,h\n";
+        // bytes are reported on close, until then the open files must not be pruned
+        if (m_cfg.retention) 
+        {
+            m_cfg.retention->pin(m_segPath);
+            m_cfg.retention->pin(m_sidePath);
+        }
+        m_segFrames = 0;
+        lock_guard<mutex> lk(m_mtx);
+        ++m_st.segments;
+        m_st.codec = m_codec;
+        return true;
+    }
+    swcLog("Video: no usable codec, segment not opened");
+    return false;
+}
+
+void SegmentRecorder::closeSegment()
+{
+    if (!m_writer.isOpened()) return;
+    m_writer.release();
+    m_sidecar.close();
+    error_code ec;
+    uint64_t bytes = fs::file_size(m_segPath, ec);
+    if (ec) bytes = 0;
+    if (m_cfg.retention) m_cfg.retention->add(m_segPath, bytes);
+    uint64_t side = fs::file_size(m_sidePath, ec);
+    if (!ec) 
+    {
+        bytes += side;
+        if (m_cfg.retention) m_cfg.retention->add(m_sidePath, side);
+    }
+    if (m_cfg.retention) 
+    {
+        m_cfg.retention->unpin(m_segPath);
+        m_cfg.retention->unpin(m_sidePath);
+    }
+    lock_guard<mutex> lk(m_mtx);
+    m_st.bytesWritten += bytes;
+}
+
+void SegmentRecorder::run()
+{
+    const uint64_t framesPerSegment = (uint64_t)max(1.0, m_cfg.fps * m_cfg.segmentSeconds);
+    cv::Size segSize;
+    double lastTs = 0.0;
+    for (;;) 
+    {
+        Item it;
+        {
+            unique_lock<mutex> lk(m_mtx);
+            m_cv.wait_for(lk, chrono::milliseconds(500), [&] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) 
+            {
+                if (m_stopping) break; // stopping and drained
+                lk.unlock();
+                // event-gated: the gate closed, finish the segment instead of leaving it open
+                if (m_cfg.eventGated && nowMs() - lastTs > m_cfg.postRollMs) closeSegment();
+                continue;
+            }
+            it = move(m_queue.front());
+            m_queue.pop_front();
+        }
+        const cv::Mat& frame = *it.frame;
+        // a new event after a gap starts its own segment
+        bool gap = m_cfg.eventGated && it.tsMs - lastTs > m_cfg.postRollMs;
+        lastTs = it.tsMs;
+        if (m_writer.isOpened() && (gap || m_segFrames >= framesPerSegment || frame.size() != segSize)) closeSegment();
+        if (!m_writer.isOpened()) 
+        {
+            segSize = frame.size();
+            if (!openSegment(segSize)) 
+            {
+                lock_guard<mutex> lk(m_mtx);
+                ++m_st.framesDropped;
+                continue;
+            }
+        }
+        double t = nowMs();
+        m_writer.write(frame);
+        double writeMs = nowMs() - t;
+        cv::Rect b(it.bbox);
+        m_sidecar << m_segFrames << ',' << steadyToWallUs(it.tsMs) << ',' << (it.tracking ? 1 : 0) << ','
+                  << b.x << ',' << b.y << ',' << b.width << ',' << b.height << '\n';
+        ++m_segFrames;
+        it.frame.reset();
+
+        lock_guard<mutex> lk(m_mtx);
+        ++m_st.framesWritten;
+        m_writeMsSum += writeMs;
+    }
+    closeSegment();
+}
+
+SegmentRecorderStats SegmentRecorder::stats() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    SegmentRecorderStats s = m_st;
+    double secs = (nowMs() - m_startMs) / 1000.0;
+    if (secs > 0) 
+    {
+        s.fps = s.framesWritten / secs;
+        s.bytesPerSec = s.bytesWritten / secs;
+    }
+    if (s.framesWritten) s.avgWriteMs = m_writeMsSum / s.framesWritten;
+    return s;
+}
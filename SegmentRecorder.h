@@ -0,0 +1,97 @@
+// SegmentRecorder.h
+// Rolling video-segment recorder on cv::VideoWriter, an alternative to per-interval JPEG stills.
+// Writes fixed-length segments (<name>.avi/.mp4) with a sidecar index (<name>.csv) holding per
+// frame timestamp and tracker bbox. Continuous, or event-gated (only while a target is tracked,
+// plus a post-roll). Runs on its own thread; push() only queues a frame handle.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "FramePool.h"
+
+class RetentionManager;
+
+struct SegmentRecorderConfig
+{
+    std::string dir = "captures/video";
+    // codecs tried in order, the first one the local OpenCV build can open wins
+    std::vector<std::string> codecs = { "avc1", "mp4v", "XVID", "MJPG" };
+    double fps = 15.0;             // recorded frame rate, input is decimated to it
+    double segmentSeconds = 60.0;  // frames per segment = fps * segmentSeconds
+    bool eventGated = false;       // record only while push(active = true), plus postRollMs
+    double postRollMs = 5000.0;
+    size_t maxQueue = 16;          // frames waiting for the writer, oldest dropped beyond this
+    RetentionManager* retention = nullptr; // told about each closed segment
+};
+
+struct SegmentRecorderStats
+{
+    uint64_t framesWritten = 0;
+    uint64_t framesDropped = 0;  // queue overflow
+    uint64_t segments = 0;
+    uint64_t bytesWritten = 0;   // closed segments + sidecars
+    double fps = 0.0;            // frames written per second of recorder uptime
+    double bytesPerSec = 0.0;
+    double avgWriteMs = 0.0;     // VideoWriter::write per frame
+    std::string codec;           // fourcc in use
+};
+
+class SegmentRecorder
+{
+public:
+    SegmentRecorder() = default;
+    ~SegmentRecorder();
+    SegmentRecorder(const SegmentRecorder&) = delete;
+    SegmentRecorder& operator=(const SegmentRecorder&) = delete;
+
+    void start(const SegmentRecorderConfig& cfg = SegmentRecorderConfig());
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+
+    // Offer a frame; active = something worth keeping is going on (gates eventGated mode)
+    void push(const FrameRef& frame, double tsMs, const cv::Rect2d& bbox, bool active);
+
+    SegmentRecorderStats stats() const;
+
+private:
+    struct Item
+    {
+        FrameRef frame;
+        double tsMs = 0.0;
+        cv::Rect2d bbox;
+        bool tracking = false;
+    };
+
+    void run();
+    bool openSegment(const cv::Size& size);
+    void closeSegment();
+
+    SegmentRecorderConfig m_cfg;
+    std::thread m_thread;
+    mutable std::mutex m_mtx;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+    std::deque<Item> m_queue;
+    double m_lastAcceptedTs = -1e18;
+    double m_gateUntil = -1e18;
+
+    // writer thread only
+    cv::VideoWriter m_writer;
+    std::ofstream m_sidecar;
+    std::string m_segPath;
+    std::string m_sidePath;
+    std::string m_codec;
+    uint64_t m_segFrames = 0;
+
+    SegmentRecorderStats m_st;
+    double m_startMs = 0.0;
+    double m_writeMsSum = 0.0;
+};
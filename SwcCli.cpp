@@ -0,0 +1,1263 @@
+// SwcCli.cpp
+// Headless console front end for the analysis engine (Linux or Windows, no camera or window needed)
+// Drives SwcEngine from a video file or an image sequence (e.g. frames/img_%04d.jpg) at full speed,
+// for profiling and capacity planning on recorded footage.
+// Build: g++ -std=c++17 -O2 SwcCli.cpp SwcEngine.cpp SwcCommon.cpp CaptureThread.cpp FramePool.cpp JpegEncoderPool.cpp FrameArchive.cpp EventRecorder.cpp SegmentRecorder.cpp RetentionManager.cpp FrameDiffDetector.cpp MotionGrid.cpp HotspotZones.cpp PersonDetector.cpp AsyncDetector.cpp DnnPersonDetector.cpp DetectScheduler.cpp TrackManager.cpp TrackerFactory.cpp BoxPredictor.cpp AppearanceGallery.cpp PreviewCompositor.cpp MjpegServer.cpp -o swccli `pkg-config --cflags --libs opencv4` -pthread
+// Usage: swccli <video|image-pattern> [--no-auto] [--select x,y,w,h] [--max-frames N]
+//               [--save dir [--archive]] [--every ms] [--encoders N] [--events dir [--preroll-mb N]]
+//               [--video dir [--gated] [--segment-s N]] [--quota-mb N] [--csv file] [--threaded [--realtime]]
+//               [--scale s] [--gray] [--motion mog2|knn|framediff] [--no-grid]
+//               [--zones file] [--hog-fallback ms] [--async-detect] [--dnn model [--dnn-config file] [--dnn-yolo]]
+//               [--cadence N[:M]] [--reverify N] [--max-tracks N [--track-threads N]] [--track-budget px]
+//               [--tracker csrt|kcf|mosse|mil|nano] [--tracker-budget ms] [--reacquire N] [--reid N] [--drift s]
+//               [--http port [--http-bind addr]]
+//        swccli --export-archive <archive-dir> <out-dir> [--from us] [--to us]
+//        swccli --bench-scales <video|image-pattern> [--max-frames N]
+//        swccli --bench-motion <video|image-pattern> [--max-frames N] [--scale s]
+//        swccli --bench-detector <video|image-pattern> --model file [--config file] [--yolo] [--batch N] [--max-frames N]
+//        swccli --bench-tracks <video|image-pattern> [--targets 1,2,4,8] [--threads 1,2,4] [--budget px] [--max-frames N]
+//        swccli --bench-trackers <video|image-pattern> [--select x,y,w,h] [--max-frames N]
+//        swccli --bench-preview <video|image-pattern> [--size WxH] [--max-frames N]
+// --quota-mb applies a retention quota to the --save directory (pruned in the background).
+// --scale/--gray run the motion path on a downscaled and/or luma frame (EngineConfig::analysisScale).
+// --zones loads hotspot zones (the UI's zones.txt format, see HotspotZones.h).
+// --hog-fallback: interval of the zone-wide HOG pass when no contour candidate exists (0 = every frame,
+// -1 = never); candidates themselves are always verified on a padded crop.
+// --async-detect runs HOG on a worker thread like the UI (results applied to a later frame, lag reported).
+// --dnn replaces HOG with a cv::dnn detector (MobileNet-SSD by default, --dnn-yolo for YOLO ONNX exports).
+// --cadence runs the detection path every N frames (adaptive up to M while calm, motion spikes reset it),
+// the tracker alone in between; --reverify re-checks the track on detector frames, dropped after N misses.
+// --max-tracks follows up to N people at once (tracker updates spread over --track-threads, 0 = per core).
+// --track-budget runs each tracker on a frame scaled so its target is about px pixels (boxes stay full-res).
+// --tracker picks the preferred backend; --tracker-budget caps the per-frame tracker time: new tracks get
+// the most preferred backend that fits their share, tracks measured over it switch to a cheaper one.
+// --reacquire: after a tracker loss only a window around the track's predicted position is scanned
+// for up to N frames (the track comes back under its id) before full-frame auto-init.
+// --reid keeps the colour descriptors of the last N lost tracks; a new track that looks like one gets
+// its id back (crops are saved as <name>_t<id>_crop.jpg).
+// --drift releases tracks whose box has held (almost) no motion-mask pixels for s seconds.
+// --http serves the analysed frames as MJPEG (/stream.mjpg, /snapshot.jpg, ?tier=high|low) on
+// 127.0.0.1:port (--http-bind 0.0.0.0 for other hosts); use --realtime to watch at the clip's rate.
+// --bench-trackers runs every available backend on the same target and ranks them by update time.
+// --bench-preview times the UI preview renderer against the old resize + convert + copy path.
+// --no-grid runs cleanup and contours on the whole mask every frame (no activity-grid early-out).
+// --threaded decodes on a CaptureThread like the UI does (latest-frame-wins, frames may be dropped),
+// --realtime additionally paces the file at its native fps to simulate a live camera
+// (the event recorder's pre/post-roll are wall-clock based, use --realtime with --events).
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+#include "SwcEngine.h"
+#include "SwcCommon.h"
+#include "DnnPersonDetector.h"
+#include "CaptureThread.h"
+#include "JpegEncoderPool.h"
+#include "FrameArchive.h"
+#include "EventRecorder.h"
+#include "SegmentRecorder.h"
+#include "RetentionManager.h"
+#include "PreviewCompositor.h"
+#include "MjpegServer.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+struct CliOptions
+{
+    string input;
+    bool autoMode = true;
+    cv::Rect2d select;
+    long long maxFrames = -1;
+    string saveDir;
+    double everyMs = 760.0;
+    int encoders = 2;
+    bool archive = false;
+    string eventsDir;
+    double prerollMb = 24.0;
+    string videoDir;
+    bool videoGated = false;
+    double segmentSeconds = 60.0;
+    double quotaMb = 0.0;
+    double scale = 1.0;
+    bool gray = false;
+    MotionBackend motion = MotionBackend::MOG2;
+    bool tileGrid = true;
+    string zonesPath;
+    double hogFallbackMs = EngineConfig().hogFallbackIntervalMs;
+    bool asyncDetect = false;
+    string dnnModel;
+    string dnnConfig;
+    bool dnnYolo = false;
+    int detectInterval = 1;
+    int detectMaxInterval = 1;
+    int reverifyFailures = 0;
+    int maxTracks = 1;
+    int trackThreads = 0;
+    double trackBudget = 0.0;
+    TrackerBackend tracker = TrackerBackend::CSRT;
+    double trackerBudgetMs = 0.0;
+    int reacquireFrames = 0;
+    int reidGallery = 0;
+    double driftSeconds = 0.0;
+    int httpPort = 0;
+    string httpBind = "127.0.0.1";
+    string csvPath;
+    bool threaded = false;
+    bool realtime = false;
+};
+
+static void usage()
+{
+    cerr << "usage: swccli <video|image-pattern> [--no-auto] [--select x,y,w,h] [--max-frames N]\n"
+            "              [--save dir [--archive]] [--every ms] [--encoders N] [--events dir [--preroll-mb N]]\n"
+            "              [--video dir [--gated] [--segment-s N]] [--quota-mb N] [--csv file] [--threaded [--realtime]]\n"
+            "              [--scale s] [--gray] [--motion mog2|knn|framediff] [--no-grid]\n"
+            "              [--zones file] [--hog-fallback ms] [--async-detect] [--dnn model [--dnn-config file] [--dnn-yolo]]\n"
+            "              [--cadence N[:M]] [--reverify N] [--max-tracks N [--track-threads N]] [--track-budget px]\n"
+            "              [--tracker csrt|kcf|mosse|mil|nano] [--tracker-budget ms] [--reacquire N] [--reid N] [--drift s]\n"
+            "              [--http port [--http-bind addr]]\n"
+            "       swccli --export-archive <archive-dir> <out-dir> [--from us] [--to us]\n"
+            "       swccli --bench-scales <video|image-pattern> [--max-frames N]\n"
+            "       swccli --bench-motion <video|image-pattern> [--max-frames N] [--scale s]\n"
+            "       swccli --bench-detector <video|image-pattern> --model file [--config file] [--yolo] [--batch N] [--max-frames N]\n"
+            "       swccli --bench-tracks <video|image-pattern> [--targets 1,2,4,8] [--threads 1,2,4] [--budget px] [--max-frames N]\n"
+            "       swccli --bench-trackers <video|image-pattern> [--select x,y,w,h] [--max-frames N]\n"
+            "       swccli --bench-preview <video|image-pattern> [--size WxH] [--max-frames N]\n";
+}
+
+static bool parseArgs(int argc, char** argv, CliOptions& o)
+{
+    for (int i = 1; i < argc; ++i) 
+    {
+        string a = argv[i];
+        bool hasNext = (i + 1 < argc);
+        if (a == "--no-auto") o.autoMode = false;
+        else if (a == "--select" && hasNext) 
+        {
+            double x, y, w, h;
+            char c1, c2, c3;
+            istringstream ss(argv[++i]);
+            if (!(ss >> x >> c1 >> y >> c2 >> w >> c3 >> h)) return false;
+            o.select = cv::Rect2d(x, y, w, h);
+        }
+        else if (a == "--max-frames" && hasNext) o.maxFrames = stoll(argv[++i]);
+        else if (a == "--save" && hasNext) o.saveDir = argv[++i];
+        else if (a == "--every" && hasNext) o.everyMs = stod(argv[++i]);
+        else if (a == "--encoders" && hasNext) o.encoders = stoi(argv[++i]);
+        else if (a == "--archive") o.archive = true;
+        else if (a == "--events" && hasNext) o.eventsDir = argv[++i];
+        else if (a == "--preroll-mb" && hasNext) o.prerollMb = stod(argv[++i]);
+        else if (a == "--video" && hasNext) o.videoDir = argv[++i];
+        else if (a == "--gated") o.videoGated = true;
+        else if (a == "--segment-s" && hasNext) o.segmentSeconds = stod(argv[++i]);
+        else if (a == "--quota-mb" && hasNext) o.quotaMb = stod(argv[++i]);
+        else if (a == "--scale" && hasNext) o.scale = stod(argv[++i]);
+        else if (a == "--gray") o.gray = true;
+        else if (a == "--no-grid") o.tileGrid = false;
+        else if (a == "--zones" && hasNext) o.zonesPath = argv[++i];
+        else if (a == "--hog-fallback" && hasNext) o.hogFallbackMs = stod(argv[++i]);
+        else if (a == "--async-detect") o.asyncDetect = true;
+        else if (a == "--dnn" && hasNext) o.dnnModel = argv[++i];
+        else if (a == "--dnn-config" && hasNext) o.dnnConfig = argv[++i];
+        else if (a == "--dnn-yolo") o.dnnYolo = true;
+        else if (a == "--cadence" && hasNext) 
+        {
+            char c = ':';
+            istringstream ss(argv[++i]);
+            if (!(ss >> o.detectInterval)) return false;
+            o.detectMaxInterval = o.detectInterval;
+            if (ss >> c && (c != ':' || !(ss >> o.detectMaxInterval))) return false;
+        }
+        else if (a == "--reverify" && hasNext) o.reverifyFailures = stoi(argv[++i]);
+        else if (a == "--max-tracks" && hasNext) o.maxTracks = stoi(argv[++i]);
+        else if (a == "--track-threads" && hasNext) o.trackThreads = stoi(argv[++i]);
+        else if (a == "--track-budget" && hasNext) o.trackBudget = stod(argv[++i]);
+        else if (a == "--tracker" && hasNext) 
+        {
+            if (!parseTrackerBackend(argv[++i], o.tracker)) return false;
+        }
+        else if (a == "--tracker-budget" && hasNext) o.trackerBudgetMs = stod(argv[++i]);
+        else if (a == "--reacquire" && hasNext) o.reacquireFrames = stoi(argv[++i]);
+        else if (a == "--reid" && hasNext) o.reidGallery = stoi(argv[++i]);
+        else if (a == "--drift" && hasNext) o.driftSeconds = stod(argv[++i]);
+        else if (a == "--http" && hasNext) o.httpPort = stoi(argv[++i]);
+        else if (a == "--http-bind" && hasNext) o.httpBind = argv[++i];
+        else if (a == "--motion" && hasNext) 
+        {
+            string m = argv[++i];
+            if (m == "mog2") o.motion = MotionBackend::MOG2;
+            else if (m == "knn") o.motion = MotionBackend::KNN;
+            else if (m == "framediff") o.motion = MotionBackend::FrameDiff;
+            else return false;
+        }
+        else if (a == "--csv" && hasNext) o.csvPath = argv[++i];
+        else if (a == "--threaded") o.threaded = true;
+        else if (a == "--realtime") o.realtime = o.threaded = true;
+        else if (!a.empty() && a[0] != '-' && o.input.empty()) o.input = a;
+        else return false;
+    }
+    return !o.input.empty();
+}
+
+// Accumulated stage times over the whole run
+struct StageTotals
+{
+    StageTimes sum;
+    StageTimes peak;
+    long long frames = 0;
+
+    void add(const StageTimes& t)
+    {
+        sum.prepare += t.prepare; peak.prepare = max(peak.prepare, t.prepare);
+        sum.motion += t.motion; peak.motion = max(peak.motion, t.motion);
+        sum.grid += t.grid; peak.grid = max(peak.grid, t.grid);
+        sum.morphology += t.morphology; peak.morphology = max(peak.morphology, t.morphology);
+        sum.contours += t.contours; peak.contours = max(peak.contours, t.contours);
+        sum.hog += t.hog; peak.hog = max(peak.hog, t.hog);
+        sum.tracker += t.tracker; peak.tracker = max(peak.tracker, t.tracker);
+        sum.total += t.total; peak.total = max(peak.total, t.total);
+        ++frames;
+    }
+};
+
+static void printStage(const char* name, double sum, double peak, long long n)
+{
+    cout << "  " << left << setw(12) << name << right << fixed << setprecision(3)
+         << setw(10) << (n ? sum / n : 0.0) << " ms avg " << setw(10) << peak << " ms max\n";
+}
+
+// Loose-file export of an archive time range, files named after the record timestamp
+static int exportArchive(int argc, char** argv)
+{
+    if (argc < 4) 
+    {
+        usage();
+        return 2;
+    }
+    string dir = argv[2], outDir = argv[3];
+    int64_t from = 0, to = INT64_MAX;
+    for (int i = 4; i + 1 < argc; i += 2) 
+    {
+        string a = argv[i];
+        if (a == "--from") from = stoll(argv[i + 1]);
+        else if (a == "--to") to = stoll(argv[i + 1]);
+    }
+    ArchiveReader reader;
+    if (!reader.open(dir)) 
+    {
+        cerr << "Error: no archive segments in " << dir << '\n';
+        return 1;
+    }
+    error_code ec;
+    fs::create_directories(outDir, ec);
+    vector<uchar> payload;
+    size_t written = 0;
+    for (size_t i = reader.seek(from); i < reader.size() && reader.record(i).tsUs <= to; ++i) 
+    {
+        const ArchiveRecord& r = reader.record(i);
+        if (!reader.readPayload(i, payload)) continue;
+        // a crop is stored 1 µs after its full frame, name it after the frame
+        string name = outDir + "/" + to_string(r.kind == ARCHIVE_CROP ? r.tsUs - 1 : r.tsUs)
+            + (r.kind == ARCHIVE_CROP ? "_crop.jpg" : ".jpg");
+        ofstream f(name, ios::binary);
+        f.write((const char*)payload.data(), (streamsize)payload.size());
+        if (f) ++written;
+    }
+    cout << "exported " << written << " of " << reader.size() << " records to " << outDir << '\n';
+    return 0;
+}
+
+// Motion path cost at each analysis scale, BGR and luma, on the same clip. The track is dropped
+// after every frame so each frame runs the full auto-init path; HOG is off since it always sees
+// the full frame. Candidate agreement is the mean IoU against the full-res BGR candidate; contours the
+// solidity filter dropped are counted so candidate counts can be compared across scales.
+static int benchScales(int argc, char** argv)
+{
+    if (argc < 3) 
+    {
+        usage();
+        return 2;
+    }
+    string input = argv[2];
+    long long maxFrames = 300;
+    for (int i = 3; i + 1 < argc; i += 2) 
+    {
+        if (string(argv[i]) == "--max-frames") maxFrames = stoll(argv[i + 1]);
+    }
+    struct Variant { double scale; bool gray; };
+    const Variant variants[] = { {1.0, false}, {1.0, true}, {0.5, false}, {0.5, true}, {0.25, false}, {0.25, true} };
+
+    vector<cv::Rect2d> reference; // per-frame candidate of the first variant, empty if none
+    cout << "scale gray    prepare     motion morphology   contours      total  candidates  rejected  IoU vs 1.0\n";
+    for (const Variant& v : variants) 
+    {
+        cv::VideoCapture cap(input);
+        if (!cap.isOpened()) 
+        {
+            cerr << "Error: could not open " << input << '\n';
+            return 1;
+        }
+        EngineConfig cfg;
+        cfg.analysisScale = v.scale;
+        cfg.analysisGray = v.gray;
+        cfg.useHog = false;
+        AnalysisEngine engine(cfg);
+        engine.setAutoMode(true);
+
+        StageTotals totals;
+        long long found = 0, matched = 0, rejected = 0;
+        double iouSum = 0.0;
+        cv::Mat frame;
+        for (long long idx = 0; idx < maxFrames && cap.read(frame) && !frame.empty(); ++idx) 
+        {
+            EngineResult res = engine.process(frame);
+            totals.add(res.times);
+            rejected += res.solidityRejected;
+            cv::Rect2d cand = res.trackerInit ? res.bbox : cv::Rect2d();
+            engine.stopTracking();
+            if (!cand.empty()) ++found;
+            if (&v == variants) reference.push_back(cand);
+            else if ((size_t)idx < reference.size() && !cand.empty() && !reference[idx].empty()) 
+            {
+                iouSum += rectIoU(cand, reference[idx]);
+                ++matched;
+            }
+        }
+        long long n = max(1LL, totals.frames);
+        cout << fixed << setprecision(3) << setw(5) << v.scale << setw(5) << (v.gray ? "y" : "n")
+             << setw(11) << totals.sum.prepare / n << setw(11) << totals.sum.motion / n
+             << setw(11) << totals.sum.morphology / n << setw(11) << totals.sum.contours / n
+             << setw(11) << totals.sum.total / n << setw(12) << found << setw(10) << rejected;
+        if (&v == variants) cout << "           -\n";
+        else cout << setw(12) << setprecision(2) << (matched ? iouSum / matched : 0.0) << '\n';
+    }
+    cout << "(ms per frame, averaged over up to " << maxFrames << " frames)\n";
+    return 0;
+}
+
+// Motion stage alone: MOG2 (with and without shadows), KNN and the frame-difference detector on
+// every kernel the CPU supports, over the same frames preloaded in memory (decode not timed).
+// The SIMD kernels must match the scalar mask bit for bit; mismatching pixels are reported.
+static int benchMotion(int argc, char** argv)
+{
+    if (argc < 3) 
+    {
+        usage();
+        return 2;
+    }
+    string input = argv[2];
+    long long maxFrames = 200;
+    double scale = 1.0;
+    for (int i = 3; i + 1 < argc; i += 2) 
+    {
+        string a = argv[i];
+        if (a == "--max-frames") maxFrames = stoll(argv[i + 1]);
+        else if (a == "--scale") scale = stod(argv[i + 1]);
+    }
+    cv::VideoCapture cap(input);
+    if (!cap.isOpened()) 
+    {
+        cerr << "Error: could not open " << input << '\n';
+        return 1;
+    }
+    vector<cv::Mat> frames;
+    cv::Mat frame;
+    while ((long long)frames.size() < maxFrames && cap.read(frame) && !frame.empty()) 
+    {
+        if (scale < 1.0) cv::resize(frame, frame, cv::Size(), scale, scale, cv::INTER_AREA);
+        frames.push_back(frame.clone());
+    }
+    if (frames.empty()) 
+    {
+        cerr << "Error: no frames in " << input << '\n';
+        return 1;
+    }
+    double mpix = frames[0].total() / 1e6;
+    const double lr = EngineConfig().learningRate;
+
+    struct Result { string name; double ms; double fgRatio; long long mismatch; };
+    vector<Result> results;
+    auto run = [&](const string& name, auto&& apply, vector<cv::Mat>* masks, const vector<cv::Mat>* ref) 
+    {
+        cv::Mat fg;
+        double total = 0.0, fgSum = 0.0;
+        long long mismatch = 0;
+        for (size_t i = 0; i < frames.size(); ++i) 
+        {
+            double t = nowMs();
+            apply(frames[i], fg);
+            total += nowMs() - t;
+            fgSum += cv::countNonZero(fg) / (double)fg.total();
+            if (masks) masks->push_back(fg.clone());
+            if (ref) 
+            {
+                cv::Mat diff;
+                cv::absdiff(fg, (*ref)[i], diff);
+                mismatch += cv::countNonZero(diff);
+            }
+        }
+        results.push_back({ name, total / frames.size(), fgSum / frames.size(), ref ? mismatch : -1 });
+    };
+
+    cv::Ptr<cv::BackgroundSubtractor> mog2 = cv::createBackgroundSubtractorMOG2(500, 16, true);
+    run("mog2", [&](const cv::Mat& f, cv::Mat& fg) { mog2->apply(f, fg, lr); }, nullptr, nullptr);
+    cv::Ptr<cv::BackgroundSubtractor> mog2ns = cv::createBackgroundSubtractorMOG2(500, 16, false);
+    run("mog2 (no shadows)", [&](const cv::Mat& f, cv::Mat& fg) { mog2ns->apply(f, fg, lr); }, nullptr, nullptr);
+    cv::Ptr<cv::BackgroundSubtractor> knn = cv::createBackgroundSubtractorKNN(500, 400.0, true);
+    run("knn", [&](const cv::Mat& f, cv::Mat& fg) { knn->apply(f, fg, lr); }, nullptr, nullptr);
+
+    vector<cv::Mat> scalarMasks;
+    const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+    for (SimdLevel level : levels) 
+    {
+        if (level > cpuSimdLevel()) break;
+        FrameDiffDetector fd;
+        fd.setSimd(level);
+        bool first = (level == SimdLevel::Scalar);
+        run(string("framediff ") + simdName(level), [&](const cv::Mat& f, cv::Mat& fg) { fd.apply(f, fg, lr); },
+            first ? &scalarMasks : nullptr, first ? nullptr : &scalarMasks);
+    }
+
+    cout << "input       " << input << " (" << frames[0].cols << "x" << frames[0].rows << ", "
+         << frames.size() << " frames)\n";
+    cout << left << setw(20) << "backend" << right << setw(10) << "ms/frame" << setw(10) << "Mpix/s"
+         << setw(10) << "speedup" << setw(10) << "fg %" << setw(12) << "mismatch\n";
+    for (const Result& r : results) 
+    {
+        cout << left << setw(20) << r.name << right << fixed << setprecision(3) << setw(10) << r.ms
+             << setprecision(1) << setw(10) << (r.ms > 0 ? mpix * 1000.0 / r.ms : 0.0)
+             << setw(9) << (r.ms > 0 ? results[0].ms / r.ms : 0.0) << 'x'
+             << setw(10) << r.fgRatio * 100.0;
+        if (r.mismatch >= 0) cout << setw(11) << r.mismatch;
+        cout << '\n';
+    }
+    return 0;
+}
+
+// Person detector cost on the same preloaded frames (full frame each, decode not timed): HOG one
+// frame per call, then the DNN one frame per forward pass and batch frames per forward pass (the
+// multi-camera case). Reports per-inference latency, throughput and detections per frame.
+static int benchDetector(int argc, char** argv)
+{
+    if (argc < 3) 
+    {
+        usage();
+        return 2;
+    }
+    string input = argv[2];
+    long long maxFrames = 64;
+    int batch = 4;
+    DnnDetectorConfig dc;
+    for (int i = 3; i < argc; ++i) 
+    {
+        string a = argv[i];
+        bool hasNext = (i + 1 < argc);
+        if (a == "--max-frames" && hasNext) maxFrames = stoll(argv[++i]);
+        else if (a == "--batch" && hasNext) batch = max(1, stoi(argv[++i]));
+        else if (a == "--model" && hasNext) dc.model = argv[++i];
+        else if (a == "--config" && hasNext) dc.config = argv[++i];
+        else if (a == "--yolo") 
+        {
+            dc.inputSize = cv::Size(640, 640);
+            dc.scale = 1.0 / 255.0;
+            dc.mean = cv::Scalar();
+            dc.swapRB = true;
+            dc.personClass = 0;
+        }
+    }
+    cv::VideoCapture cap(input);
+    if (!cap.isOpened()) 
+    {
+        cerr << "Error: could not open " << input << '\n';
+        return 1;
+    }
+    vector<cv::Mat> frames;
+    cv::Mat frame;
+    while ((long long)frames.size() < maxFrames && cap.read(frame) && !frame.empty()) frames.push_back(frame.clone());
+    if (frames.empty()) 
+    {
+        cerr << "Error: no frames in " << input << '\n';
+        return 1;
+    }
+
+    cout << "input       " << input << " (" << frames[0].cols << "x" << frames[0].rows << ", "
+         << frames.size() << " frames)\n";
+    cout << left << setw(20) << "detector" << right << setw(8) << "batch" << setw(12) << "ms/infer"
+         << setw(12) << "max ms" << setw(10) << "img/s" << setw(12) << "dets/frame\n";
+    auto print = [](const string& name, int b, double avg, double mx, double ips, double dets) 
+    {
+        cout << left << setw(20) << name << right << setw(8) << b << fixed << setprecision(2) << setw(12) << avg
+             << setw(12) << mx << setprecision(1) << setw(10) << ips << setprecision(2) << setw(11) << dets << '\n';
+    };
+
+    HogPersonDetector hog;
+    hog.warmUp();
+    double sum = 0.0, mx = 0.0;
+    size_t dets = 0;
+    vector<cv::Rect> found;
+    for (const cv::Mat& f : frames) 
+    {
+        double t = nowMs();
+        hog.detect(f, found);
+        double ms = nowMs() - t;
+        sum += ms;
+        mx = max(mx, ms);
+        dets += found.size();
+    }
+    print("hog", 1, sum / frames.size(), mx, sum > 0 ? frames.size() * 1000.0 / sum : 0.0, dets / (double)frames.size());
+
+    if (dc.model.empty()) 
+    {
+        cout << "(no --model, DNN skipped)\n";
+        return 0;
+    }
+    vector<int> batches = { 1 };
+    if (batch > 1) batches.push_back(batch);
+    for (int b : batches) 
+    {
+        dc.maxBatch = b;
+        DnnPersonDetector dnn(dc);
+        if (!dnn.loaded()) 
+        {
+            cerr << "Error: " << dnn.error() << '\n';
+            return 1;
+        }
+        dnn.warmUp();
+        dets = 0;
+        vector<vector<cv::Rect>> out;
+        for (size_t i = 0; i < frames.size(); i += b) 
+        {
+            vector<cv::Mat> part(frames.begin() + i, frames.begin() + min(frames.size(), i + (size_t)b));
+            dnn.detectBatch(part, out);
+            for (auto& o : out) dets += o.size();
+        }
+        DnnDetectorStats ds = dnn.stats();
+        // a fixed-batch model drops to batch 1 on the first failed pass
+        int used = ds.inferences ? (int)((ds.images + ds.inferences - 1) / ds.inferences) : b;
+        print("dnn", used, ds.avgInferMs, ds.maxInferMs, ds.imagesPerSec, dets / (double)frames.size());
+    }
+    return 0;
+}
+
+static vector<int> parseIntList(const string& s)
+{
+    vector<int> out;
+    istringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) 
+    {
+        if (!item.empty()) out.push_back(max(1, stoi(item)));
+    }
+    return out;
+}
+
+// Tracker update cost with 1..N simultaneous targets on 1..cores update threads, over the same
+// preloaded frames. Targets are seeded on a grid over the first frame (the update cost hardly
+// depends on content); lost trackers are re-seeded untimed, so every frame updates all of them.
+static int benchTracks(int argc, char** argv)
+{
+    if (argc < 3) 
+    {
+        usage();
+        return 2;
+    }
+    string input = argv[2];
+    long long maxFrames = 100;
+    vector<int> targets = { 1, 2, 4, 8 };
+    vector<int> threads;
+    double budget = 0.0;
+    for (int i = 3; i + 1 < argc; i += 2) 
+    {
+        string a = argv[i];
+        if (a == "--max-frames") maxFrames = stoll(argv[i + 1]);
+        else if (a == "--budget") budget = stod(argv[i + 1]);
+        else if (a == "--targets") targets = parseIntList(argv[i + 1]);
+        else if (a == "--threads") threads = parseIntList(argv[i + 1]);
+    }
+    if (threads.empty()) 
+    {
+        int hw = max(1, (int)thread::hardware_concurrency());
+        for (int n = 1; n < hw; n *= 2) threads.push_back(n);
+        threads.push_back(hw);
+    }
+    cv::VideoCapture cap(input);
+    if (!cap.isOpened()) 
+    {
+        cerr << "Error: could not open " << input << '\n';
+        return 1;
+    }
+    vector<cv::Mat> frames;
+    cv::Mat frame;
+    while ((long long)frames.size() < maxFrames && cap.read(frame) && !frame.empty()) frames.push_back(frame.clone());
+    if (frames.size() < 2) 
+    {
+        cerr << "Error: need at least 2 frames in " << input << '\n';
+        return 1;
+    }
+    TrackerFactory factory;
+    if (!factory.create(factory.choose(0.0))) 
+    {
+        cerr << "Error: no tracker available in this OpenCV build\n";
+        return 1;
+    }
+
+    auto seedBoxes = [&](int n) 
+    {
+        int cols = (int)ceil(sqrt((double)n));
+        int rows = (n + cols - 1) / cols;
+        double cw = frames[0].cols / (double)cols, ch = frames[0].rows / (double)rows;
+        vector<cv::Rect2d> boxes;
+        for (int i = 0; i < n; ++i) 
+            boxes.emplace_back((i % cols) * cw + cw / 4, (i / cols) * ch + ch / 8, cw / 2, ch * 3 / 4);
+        return boxes;
+    };
+    auto seed = [](TrackManager& tm, const cv::Mat& f, const cv::Rect2d& box) { tm.spawn(f, box, 0.0, false); };
+
+    cout << "input       " << input << " (" << frames[0].cols << "x" << frames[0].rows << ", "
+         << frames.size() << " frames, " << thread::hardware_concurrency() << " cores)\n";
+    cout << setw(8) << "targets" << setw(9) << "threads" << setw(12) << "ms/frame" << setw(14) << "updates/s"
+         << setw(10) << "speedup" << setw(9) << "reseeds\n";
+    for (int n : targets) 
+    {
+        vector<cv::Rect2d> boxes = seedBoxes(n);
+        double base = 0.0;
+        for (int th : threads) 
+        {
+            TrackManager tm(th);
+            tm.setFactory(&factory);
+            tm.setPixelBudget(budget);
+            for (const cv::Rect2d& b : boxes) seed(tm, frames[0], b);
+            double total = 0.0;
+            long long updates = 0, reseeds = 0;
+            vector<Track> lost;
+            for (size_t i = 1; i < frames.size(); ++i) 
+            {
+                updates += tm.size();
+                double t = nowMs();
+                tm.update(frames[i], lost);
+                total += nowMs() - t;
+                for (size_t k = tm.size(); k < boxes.size(); ++k, ++reseeds) seed(tm, frames[i], boxes[k]);
+            }
+            double ms = total / (frames.size() - 1);
+            if (th == threads.front()) base = ms;
+            cout << setw(8) << n << setw(9) << tm.threads() << fixed << setprecision(2) << setw(12) << ms
+                 << setprecision(0) << setw(14) << (total > 0 ? updates * 1000.0 / total : 0.0)
+                 << setprecision(2) << setw(9) << (ms > 0 ? base / ms : 0.0) << 'x' << setw(8) << reseeds << '\n';
+        }
+    }
+    return 0;
+}
+
+// Every available tracker backend on the same target over the same frames, cheapest first.
+// Drift is reported as the mean IoU with the CSRT track (the most accurate classic one).
+static int benchTrackers(int argc, char** argv)
+{
+    if (argc < 3) 
+    {
+        usage();
+        return 2;
+    }
+    string input = argv[2];
+    long long maxFrames = 300;
+    cv::Rect2d select;
+    for (int i = 3; i + 1 < argc; ++i) 
+    {
+        string a = argv[i];
+        if (a == "--max-frames") maxFrames = stoll(argv[i + 1]);
+        else if (a == "--select") 
+        {
+            double x, y, w, h;
+            char c1, c2, c3;
+            istringstream ss(argv[i + 1]);
+            if (ss >> x >> c1 >> y >> c2 >> w >> c3 >> h) select = cv::Rect2d(x, y, w, h);
+        }
+    }
+    cv::VideoCapture cap(input);
+    if (!cap.isOpened()) 
+    {
+        cerr << "Error: could not open " << input << '\n';
+        return 1;
+    }
+    vector<cv::Mat> frames;
+    cv::Mat frame;
+    while ((long long)frames.size() < maxFrames && cap.read(frame) && !frame.empty()) frames.push_back(frame.clone());
+    if (frames.size() < 2) 
+    {
+        cerr << "Error: need at least 2 frames in " << input << '\n';
+        return 1;
+    }
+    // default target: a person-sized box in the middle of the first frame
+    if (select.area() <= 0) 
+    {
+        double h = frames[0].rows / 2.0;
+        select = cv::Rect2d((frames[0].cols - h / 2) / 2, (frames[0].rows - h) / 2, h / 2, h);
+    }
+
+    struct Run
+    {
+        TrackerBackend backend;
+        double initMs = 0.0, avgMs = 0.0, maxMs = 0.0;
+        int lost = -1;   // first frame the tracker gave up on, -1 = never
+        vector<cv::Rect2d> boxes;
+    };
+    TrackerFactory factory;
+    vector<Run> runs;
+    for (int i = 0; i < (int)TrackerBackend::Count; ++i) 
+    {
+        Run r;
+        r.backend = (TrackerBackend)i;
+        cv::Ptr<cv::Tracker> t = factory.create(r.backend);
+        if (!t) continue;
+        double sum = 0.0;
+        int updates = 0;
+        try 
+        {
+            double t0 = nowMs();
+            t->init(frames[0], cv::Rect(select));
+            r.initMs = nowMs() - t0;
+            r.boxes.push_back(select);
+            for (size_t f = 1; f < frames.size(); ++f) 
+            {
+                cv::Rect box;
+                t0 = nowMs();
+                bool ok = t->update(frames[f], box);
+                double ms = nowMs() - t0;
+                sum += ms;
+                ++updates;
+                r.maxMs = max(r.maxMs, ms);
+                if (!ok) 
+                {
+                    r.lost = (int)f;
+                    break;
+                }
+                r.boxes.push_back(box);
+            }
+        }
+        catch (const cv::Exception& e) 
+        {
+            cerr << trackerBackendName(r.backend) << ": " << e.what() << '\n';
+            continue;
+        }
+        r.avgMs = updates ? sum / updates : 0.0;
+        runs.push_back(move(r));
+    }
+    if (runs.empty()) 
+    {
+        cerr << "Error: no tracker available in this OpenCV build\n";
+        return 1;
+    }
+    sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.avgMs < b.avgMs; });
+    const Run* ref = nullptr;
+    for (const Run& r : runs) if (r.backend == TrackerBackend::CSRT) ref = &r;
+
+    cout << "input       " << input << " (" << frames[0].cols << "x" << frames[0].rows << ", " << frames.size()
+         << " frames, target " << (int)select.width << "x" << (int)select.height << ")\n";
+    cout << left << setw(8) << "backend" << right << setw(10) << "init ms" << setw(10) << "avg ms" << setw(10) << "max ms"
+         << setw(10) << "fps" << setw(8) << "lost" << setw(12) << "IoU csrt\n";
+    for (const Run& r : runs) 
+    {
+        cout << left << setw(8) << trackerBackendName(r.backend) << right << fixed << setprecision(2)
+             << setw(10) << r.initMs << setw(10) << r.avgMs << setw(10) << r.maxMs
+             << setprecision(0) << setw(10) << (r.avgMs > 0 ? 1000.0 / r.avgMs : 0.0)
+             << setw(8) << (r.lost >= 0 ? to_string(r.lost) : string("-"));
+        if (ref && ref != &r) 
+        {
+            size_t n = min(r.boxes.size(), ref->boxes.size());
+            double iou = 0.0;
+            for (size_t f = 0; f < n; ++f) iou += rectIoU(r.boxes[f], ref->boxes[f]);
+            cout << setprecision(2) << setw(11) << (n ? iou / n : 0.0);
+        }
+        else 
+        {
+            cout << setw(11) << "-";
+        }
+        cout << '\n';
+    }
+    return 0;
+}
+
+// The UI preview path on every frame: before, clone + cv::resize + BGRA conversion + a fresh bitmap
+// the converted image is copied into (what the old MatToHBITMAP did per paint); now, the compositor
+// rendering into one kept canvas. Both draw into a WxH preview (default 1280x720) with the letterbox.
+static int benchPreview(int argc, char** argv)
+{
+    if (argc < 3) 
+    {
+        usage();
+        return 2;
+    }
+    string input = argv[2];
+    long long maxFrames = 300;
+    cv::Size size(1280, 720);
+    for (int i = 3; i + 1 < argc; ++i) 
+    {
+        string a = argv[i];
+        if (a == "--max-frames") maxFrames = stoll(argv[i + 1]);
+        else if (a == "--size") 
+        {
+            int w, h;
+            char x;
+            istringstream ss(argv[i + 1]);
+            if (ss >> w >> x >> h && w > 0 && h > 0) size = cv::Size(w, h);
+        }
+    }
+    cv::VideoCapture cap(input);
+    if (!cap.isOpened()) 
+    {
+        cerr << "Error: could not open " << input << '\n';
+        return 1;
+    }
+    vector<cv::Mat> frames;
+    cv::Mat frame;
+    while ((long long)frames.size() < maxFrames && cap.read(frame) && !frame.empty()) frames.push_back(frame.clone());
+    if (frames.empty()) 
+    {
+        cerr << "Error: no frames in " << input << '\n';
+        return 1;
+    }
+
+    // a typical overlay load: two tracks and a zone
+    PreviewScene scene;
+    cv::Rect2d box(frames[0].cols * 0.4, frames[0].rows * 0.25, frames[0].cols * 0.15, frames[0].rows * 0.5);
+    for (int i = 0; i < 2; ++i) 
+    {
+        PreviewRect r;
+        r.rect = box + cv::Point2d(i * box.width * 1.5 - box.width, 0);
+        r.color = i == 0 ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 200, 255);
+        r.thickness = 2;
+        r.label = "#" + to_string(i + 1);
+        scene.rects.push_back(r);
+    }
+    PreviewPolyline zone;
+    zone.points = { cv::Point2f(10, 10), cv::Point2f(frames[0].cols * 0.5f, 10), cv::Point2f(frames[0].cols * 0.5f, frames[0].rows * 0.5f) };
+    zone.color = cv::Scalar(255, 160, 0);
+    scene.polylines.push_back(zone);
+
+    double legacyMs = 0.0, legacyMax = 0.0;
+    size_t checksum = 0; // keeps both outputs observable so nothing is optimized away
+    for (const cv::Mat& f : frames) 
+    {
+        double t0 = nowMs();
+        double s = min(double(size.width) / f.cols, double(size.height) / f.rows);
+        cv::Mat copy = f.clone(), resized, bgra;
+        cv::resize(copy, resized, cv::Size(int(f.cols * s), int(f.rows * s)));
+        cv::cvtColor(resized, bgra, cv::COLOR_BGR2BGRA);
+        vector<uchar> bitmap(bgra.total() * bgra.elemSize());
+        memcpy(bitmap.data(), bgra.data, bitmap.size());
+        double ms = nowMs() - t0;
+        legacyMs += ms;
+        legacyMax = max(legacyMax, ms);
+        checksum += bitmap[bitmap.size() / 2];
+    }
+
+    PreviewCompositor comp;
+    comp.resize(size.width, size.height);
+    comp.render(frames[0], scene); // builds the tables once, like the first paint
+    double fusedMs = 0.0, fusedMax = 0.0;
+    for (const cv::Mat& f : frames) 
+    {
+        double t0 = nowMs();
+        comp.render(f, scene);
+        double ms = nowMs() - t0;
+        fusedMs += ms;
+        fusedMax = max(fusedMax, ms);
+        checksum += comp.canvas().data[comp.canvas().total() * 2];
+    }
+
+    double n = (double)frames.size();
+    cout << "input       " << input << " (" << frames[0].cols << "x" << frames[0].rows << ", " << frames.size()
+         << " frames) -> " << size.width << "x" << size.height << " preview, checksum " << checksum << "\n";
+    cout << fixed << setprecision(3);
+    cout << "legacy      " << legacyMs / n << " ms/frame avg, " << legacyMax << " ms max (no overlays)\n";
+    cout << "compositor  " << fusedMs / n << " ms/frame avg, " << fusedMax << " ms max (overlays included), "
+         << comp.stats().reallocations << " allocations, " << comp.stats().tableBuilds << " table builds\n";
+    cout << setprecision(2) << "speedup     " << (fusedMs > 0 ? legacyMs / fusedMs : 0.0) << "x\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && string(argv[1]) == "--export-archive") return exportArchive(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "--bench-scales") return benchScales(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "--bench-motion") return benchMotion(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "--bench-detector") return benchDetector(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "--bench-tracks") return benchTracks(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "--bench-trackers") return benchTrackers(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "--bench-preview") return benchPreview(argc, argv);
+
+    CliOptions opt;
+    if (!parseArgs(argc, argv, opt)) 
+    {
+        usage();
+        return 2;
+    }
+
+    cv::VideoCapture cap(opt.input);
+    if (!cap.isOpened()) 
+    {
+        cerr << "Error: could not open " << opt.input << '\n';
+        return 1;
+    }
+    double fps = cap.get(cv::CAP_PROP_FPS);
+    if (fps <= 0) fps = 30.0;
+
+    // threaded mode: the capture thread owns its own VideoCapture on the same input
+    CaptureThread capture;
+    FramePool pool(12); // frames in flight: engine + encoder queue
+    if (opt.threaded) 
+    {
+        cap.release();
+        CaptureSource src;
+        src.path = opt.input;
+        src.paceFps = opt.realtime ? fps : 0.0;
+        if (!capture.start(src)) 
+        {
+            cerr << "Error: capture thread could not open " << opt.input << '\n';
+            return 1;
+        }
+    }
+    auto grab = [&](TimedFrame& tf) -> bool
+    {
+        if (!opt.threaded) 
+        {
+            shared_ptr<cv::Mat> buf = pool.acquire();
+            tf.tsMs = nowMs();
+            if (!cap.read(*buf) || buf->empty()) return false;
+            tf.image = move(buf);
+            return true;
+        }
+        for (;;) 
+        {
+            bool wasRunning = capture.running();
+            if (capture.latest(tf)) return true;
+            if (!wasRunning) return false; // source finished and ring drained
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    };
+
+    if (!opt.saveDir.empty()) 
+    {
+        try { if (!fs::exists(opt.saveDir)) fs::create_directories(opt.saveDir); }
+        catch (const exception& e) 
+        {
+            cerr << "Failed to create output directory: " << e.what() << '\n';
+            return 1;
+        }
+    }
+    ofstream csv;
+    if (!opt.csvPath.empty()) 
+    {
+        csv.open(opt.csvPath);
+        csv << "frame,stream_ms,prepare,motion,grid,morphology,contours,hog,tracker,total,tracking,dirty_tiles,detector\n";
+    }
+
+    JpegEncoderPool encoder;
+    ArchiveWriter archive;
+    RetentionManager retention;
+    if (!opt.saveDir.empty()) 
+    {
+        RetentionManager* quota = nullptr;
+        if (opt.quotaMb > 0) 
+        {
+            RetentionConfig qc;
+            qc.root = opt.saveDir;
+            qc.maxBytes = (uint64_t)(opt.quotaMb * 1024 * 1024);
+            qc.maxAgeHours = 0;
+            qc.minFreeBytes = 0;
+            qc.activeGraceMs = 2000.0; // offline runs are short
+            retention.start(qc);
+            quota = &retention;
+        }
+        // offline run: never drop, let the queue apply back-pressure instead
+        EncoderConfig ec;
+        ec.workers = opt.encoders;
+        ec.policy = DropPolicy::Block;
+        ec.retention = quota;
+        if (opt.archive) 
+        {
+            ArchiveConfig ac;
+            ac.dir = opt.saveDir + "/archive";
+            ac.retention = quota;
+            if (!archive.open(ac)) 
+            {
+                cerr << "Error: cannot create archive in " << ac.dir << '\n';
+                return 1;
+            }
+            ec.archive = &archive;
+        }
+        encoder.start(ec);
+    }
+    int64_t wall0Us = wallClockUs();
+    double wall0Ms = nowMs();
+
+    EventRecorder events;
+    if (!opt.eventsDir.empty()) 
+    {
+        EventRecorderConfig rc;
+        rc.dir = opt.eventsDir;
+        rc.ringBytes = (size_t)(opt.prerollMb * 1024 * 1024);
+        events.start(rc);
+    }
+
+    SegmentRecorder video;
+    if (!opt.videoDir.empty()) 
+    {
+        SegmentRecorderConfig vc;
+        vc.dir = opt.videoDir;
+        vc.eventGated = opt.videoGated;
+        vc.segmentSeconds = opt.segmentSeconds;
+        vc.fps = min(vc.fps, fps);
+        vc.maxQueue = 256; // offline: queue deep rather than drop
+        video.start(vc);
+    }
+
+    MjpegServer http;
+    if (opt.httpPort > 0) 
+    {
+        MjpegConfig hc;
+        hc.port = opt.httpPort;
+        hc.bindAddress = opt.httpBind;
+        if (!http.start(hc)) 
+        {
+            cerr << "Error: cannot listen on " << opt.httpBind << ":" << opt.httpPort << '\n';
+            return 1;
+        }
+        cerr << "Live view on http://" << opt.httpBind << ":" << opt.httpPort << "/\n";
+    }
+
+    EngineConfig cfg;
+    cfg.analysisScale = opt.scale;
+    cfg.analysisGray = opt.gray;
+    cfg.motionBackend = opt.motion;
+    cfg.useTileGrid = opt.tileGrid;
+    cfg.hogFallbackIntervalMs = opt.hogFallbackMs;
+    cfg.asyncDetector = opt.asyncDetect;
+    cfg.dnnModel = opt.dnnModel;
+    cfg.dnnConfig = opt.dnnConfig;
+    cfg.detectInterval = opt.detectInterval;
+    cfg.detectMaxInterval = opt.detectMaxInterval;
+    cfg.reverifyFailures = opt.reverifyFailures;
+    cfg.maxTracks = opt.maxTracks;
+    cfg.trackThreads = opt.trackThreads;
+    cfg.trackPixelBudget = opt.trackBudget;
+    cfg.tracker = opt.tracker;
+    cfg.trackerBudgetMs = opt.trackerBudgetMs;
+    cfg.reacquireFrames = opt.reacquireFrames;
+    cfg.reidGallery = opt.reidGallery;
+    cfg.driftSeconds = opt.driftSeconds;
+    if (opt.dnnYolo) 
+    {
+        cfg.dnnYolo = true;
+        cfg.dnnInputSize = 640;
+        cfg.dnnPersonClass = 0;
+    }
+    AnalysisEngine engine(cfg);
+    engine.setAutoMode(opt.autoMode);
+    if (!opt.zonesPath.empty()) 
+    {
+        vector<Zone> zones;
+        if (!loadZones(opt.zonesPath, zones)) 
+        {
+            cerr << "Error: cannot read zones from " << opt.zonesPath << '\n';
+            return 1;
+        }
+        engine.setZones(zones);
+    }
+
+    StageTotals totals;
+    long long inits = 0, losses = 0, verifyMisses = 0;
+    size_t peakTracks = 0;
+    long long gridFrames = 0, quietFrames = 0, dirtySum = 0;
+    double nextSave = 0.0;
+    double grabMs = 0.0;
+    double wall0 = nowMs();
+    cv::Size frameSize;
+    TimedFrame tf;
+    for (long long idx = 0; opt.maxFrames < 0 || idx < opt.maxFrames; ++idx) 
+    {
+        double t = nowMs();
+        if (!grab(tf)) break;
+        const cv::Mat& frame = *tf.image;
+        frameSize = frame.size();
+        grabMs += nowMs() - t;
+        // stream time drives the save interval, image sequences have no timestamps
+        double streamMs = opt.threaded ? (tf.seq - 1) * 1000.0 / fps : idx * 1000.0 / fps;
+
+        if (idx == 0 && !opt.select.empty()) 
+        {
+            if (!engine.startTracking(frame, opt.select)) cerr << "Warning: --select tracker init failed\n";
+        }
+
+        EngineResult res = engine.process(tf.image, tf.tsMs);
+        totals.add(res.times);
+        if (res.trackerInit) ++inits;
+        if (res.trackerLost) ++losses;
+        peakTracks = max(peakTracks, res.tracks.size());
+        if (res.verified < 0) ++verifyMisses;
+        if (res.dirtyTiles >= 0) 
+        {
+            ++gridFrames;
+            dirtySum += res.dirtyTiles;
+            if (res.dirtyTiles == 0) ++quietFrames;
+        }
+        if (events.running()) 
+        {
+            events.push(tf.image, tf.tsMs);
+            if (res.trackerInit) events.trigger("auto-init");
+            else if (res.tracking) events.extend();
+        }
+        // stream time keeps the recorded rate right when decoding faster than real time
+        if (video.running()) video.push(tf.image, wall0Ms + streamMs, res.bbox, res.tracking);
+        http.publish(tf.image);
+
+        if (csv) 
+        {
+            csv << idx << ',' << streamMs << ',' << res.times.prepare << ',' << res.times.motion << ','
+                << res.times.grid << ',' << res.times.morphology << ',' << res.times.contours << ','
+                << res.times.hog << ',' << res.times.tracker << ',' << res.times.total << ','
+                << (res.tracking ? 1 : 0) << ',' << res.dirtyTiles << ',' << (res.detectorFrame ? 1 : 0) << '\n';
+        }
+
+        if (!opt.saveDir.empty() && streamMs >= nextSave) 
+        {
+            ostringstream base;
+            base << opt.saveDir << "/frame_" << setw(6) << setfill('0') << idx;
+            EncodeJob job;
+            job.frame = tf.image;
+            job.tsMs = tf.tsMs;
+            job.basePath = base.str();
+            // archive timestamps follow stream time so seeks map onto the clip
+            job.wallUs = wall0Us + (int64_t)(streamMs * 1000.0);
+            if (res.tracking && !res.bbox.empty()) 
+            {
+                job.bbox = job.crop = cv::Rect(res.bbox);
+                if (const Track* p = engine.tracks().primary()) job.trackId = p->id;
+            }
+            encoder.submit(move(job));
+            nextSave = streamMs + opt.everyMs;
+        }
+    }
+    capture.stop();
+    encoder.stop(true);
+    archive.close();
+    events.stop();
+    video.stop();
+    retention.stop();
+    http.stop();
+    double wallMs = nowMs() - wall0;
+
+    long long n = totals.frames;
+    cout << "input       " << opt.input << " (" << frameSize.width << "x" << frameSize.height << ", " << fps << " fps)\n";
+    cout << "frames      " << n << " in " << fixed << setprecision(1) << wallMs << " ms, "
+         << setprecision(1) << (wallMs > 0 ? n * 1000.0 / wallMs : 0.0) << " fps end-to-end\n";
+    cout << "tracks      " << inits << " auto-inits, " << losses << " losses, " << peakTracks << " at once (max "
+         << opt.maxTracks << ", " << engine.tracks().threads() << " update threads), " << engine.tracks().rescales()
+         << " budget rescales, " << engine.tracks().backendSwitches() << " backend switches, " << engine.driftReleases() << " drift releases\n";
+    const ReacquireStats& rq = engine.reacquireStats();
+    if (rq.losses > 0) 
+    {
+        cout << "reacquire   " << rq.recovered << "/" << rq.losses << " lost tracks found near their prediction (avg "
+             << setprecision(1) << (rq.recovered ? rq.recoverFrames / (double)rq.recovered : 0.0) << " frames), "
+             << rq.escalated << " left to auto-init, " << rq.scans << " window scans "
+             << setprecision(2) << (rq.scans ? rq.scanMs / rq.scans : 0.0) << " ms avg\n";
+    }
+    const GalleryStats& gs = engine.gallery().stats();
+    if (gs.queries > 0) 
+    {
+        cout << "reid        " << gs.matches << "/" << gs.queries << " new tracks re-identified, " << gs.added
+             << " lost tracks kept (" << gs.evicted << " evicted, " << gs.expired << " expired), match "
+             << setprecision(2) << gs.avgQueryUs << " us avg " << gs.maxQueryUs << " us max\n";
+    }
+    cout << "stages\n";
+    printStage("grab", grabMs, 0.0, n);
+    printStage("prepare", totals.sum.prepare, totals.peak.prepare, n);
+    printStage("motion", totals.sum.motion, totals.peak.motion, n);
+    printStage("grid", totals.sum.grid, totals.peak.grid, n);
+    printStage("morphology", totals.sum.morphology, totals.peak.morphology, n);
+    printStage("contours", totals.sum.contours, totals.peak.contours, n);
+    printStage("hog", totals.sum.hog, totals.peak.hog, n);
+    printStage("tracker", totals.sum.tracker, totals.peak.tracker, n);
+    printStage("engine", totals.sum.total, totals.peak.total, n);
+    if (opt.asyncDetect) 
+    {
+        AsyncDetectorStats ds = engine.detectorStats();
+        cout << "detector    " << ds.completed << "/" << ds.submitted << " async requests in " << ds.batches
+             << " batches, " << ds.superseded
+             << " superseded, warm-up " << setprecision(2) << ds.warmUpMs << " ms, detect " << ds.avgDetectMs
+             << " ms avg " << ds.maxDetectMs << " ms max, lag " << ds.avgLagMs << " ms avg " << ds.maxLagMs
+             << " ms max, " << engine.staleDetections() << " stale\n";
+    }
+    if (!engine.scheduler().everyFrame() || opt.reverifyFailures > 0) 
+    {
+        const CadenceStats& cs = engine.scheduler().stats();
+        cout << "cadence     " << cs.detectorFrames << "/" << cs.frames << " detector frames, " << cs.spikes
+             << " motion spikes, interval " << opt.detectInterval << ".." << opt.detectMaxInterval << " (now "
+             << engine.scheduler().interval() << "), " << verifyMisses << " failed verifications\n";
+    }
+    if (gridFrames > 0) 
+    {
+        const MotionGrid& g = engine.grid();
+        cout << "grid        " << quietFrames << "/" << gridFrames << " auto-init frames quiet (early-out), "
+             << setprecision(1) << (double)dirtySum / gridFrames << " dirty tiles avg";
+        if (g.cols() > 0) cout << " of " << g.cols() * g.rows();
+        cout << '\n';
+    }
+    if (opt.httpPort > 0) 
+    {
+        MjpegStats hs = http.stats();
+        cout << "http        " << hs.connections << " connections (" << hs.rejected << " rejected), " << hs.peakClients
+             << " viewers peak, " << hs.encoded << " encodes for " << hs.published << " frames, " << hs.framesSent
+             << " sent, " << hs.framesSkipped << " skipped for slow viewers, " << hs.bytesSent / 1024 << " KiB, encode "
+             << setprecision(2) << hs.avgEncodeMs << " ms avg " << hs.maxEncodeMs << " ms max\n";
+    }
+    if (opt.threaded) 
+    {
+        CaptureStats cs = capture.stats();
+        cout << "capture     " << cs.captured << " grabbed, " << cs.delivered << " analysed, "
+             << cs.overwritten << " overwritten, " << cs.dropped << " dropped\n";
+    }
+    if (!opt.saveDir.empty()) 
+    {
+        EncoderStats es = encoder.stats();
+        cout << "encoder     " << es.filesWritten << " files, " << es.bytesWritten / 1024 << " KiB, " << es.dropped
+             << " dropped, peak queue " << es.peakQueueDepth << ", encode " << setprecision(2) << es.avgEncodeMs
+             << " ms avg " << es.maxEncodeMs << " ms max, latency " << es.avgLatencyMs << " ms avg\n";
+    }
+    if (!opt.eventsDir.empty()) 
+    {
+        EventRecorderStats rs = events.stats();
+        cout << "events      " << rs.events << " clips, " << rs.clipFrames << " frames, " << rs.clipBytes / 1024
+             << " KiB, pre-roll peak " << rs.peakFootprint / 1024 << " KiB, encode " << rs.avgEncodeMs
+             << " ms avg, flush " << rs.lastFlushMs << " ms last " << rs.maxFlushMs << " ms max\n";
+    }
+    if (!opt.videoDir.empty()) 
+    {
+        SegmentRecorderStats vs = video.stats();
+        cout << "video       " << vs.codec << ", " << vs.segments << " segments, " << vs.framesWritten << " frames, "
+             << vs.bytesWritten / 1024 << " KiB, " << vs.fps << " fps / " << vs.bytesPerSec / 1024 << " KiB/s written, "
+             << vs.framesDropped << " dropped, write " << vs.avgWriteMs << " ms avg\n";
+    }
+    if (opt.quotaMb > 0) 
+    {
+        RetentionStats qs = retention.stats();
+        cout << "retention   " << qs.totalBytes / 1024 << " KiB in " << qs.files << " files, " << qs.prunedFiles
+             << " pruned (" << qs.prunedBytes / 1024 << " KiB), scan " << qs.scanMs << " ms, last prune "
+             << qs.lastPruneMs << " ms\n";
+    }
+    PoolStats ps = opt.threaded ? capture.stats().pool : pool.stats();
+    cout << "frame pool  " << ps.capacity << " buffers, peak " << ps.peakInUse << " in use, "
+         << ps.reused << "/" << ps.acquired << " reused, " << ps.exhausted << " exhausted, "
+         << ps.escaped << " escaped\n";
+    return 0;
+}
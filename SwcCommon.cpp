@@ -0,0 +1,143 @@
+// SwcCommon.cpp
+// Platform-neutral helpers, see SwcCommon.h
+//
+
+#include "SwcCommon.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static atomic<LogSink> g_logSink{ nullptr };
+
+static void stderrSink(const char* s)
+{
+    fprintf(stderr, "%s\n", s);
+}
+
+void setLogSink(LogSink sink)
+{
+    g_logSink = sink;
+}
+
+void swcLog(const char* s)
+{
+    LogSink sink = g_logSink.load();
+    if (sink) sink(s);
+    else stderrSink(s);
+}
+
+void swcLog(const string& s)
+{
+    swcLog(s.c_str());
+}
+
+double nowMs()
+{
+    static const auto t0 = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+int64_t wallClockUs()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t steadyToWallUs(double tsMs)
+{
+    return wallClockUs() - (int64_t)((nowMs() - tsMs) * 1000.0);
+}
+
+string timestampFilename() 
+{
+    static mutex mtx;
+    static string lastName;
+    static int repeat = 0;
+
+    auto now = chrono::system_clock::now();
+    time_t t = chrono::system_clock::to_time_t(now);
+    int ms = (int)(chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()).count() % 1000);
+    tm tm;
+#if defined(_MSC_VER)
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    ostringstream ss;
+    ss << put_time(&tm, "%Y%m%d_%H%M%S") << '_' << setw(3) << setfill('0') << ms;
+    string name = ss.str();
+
+    lock_guard<mutex> lk(mtx);
+    if (name == lastName) return name + "_" + to_string(++repeat);
+    lastName = name;
+    repeat = 0;
+    return name;
+}
+
+cv::Rect2d clampRect(const cv::Rect2d& r, int cols, int rows)
+{
+    cv::Rect2d c = r;
+    c.x = max(0.0, c.x);
+    c.y = max(0.0, c.y);
+    c.width = max(0.0, min(c.width, double(cols) - c.x));
+    c.height = max(0.0, min(c.height, double(rows) - c.y));
+    return c;
+}
+
+double rectIoU(const cv::Rect2d& a, const cv::Rect2d& b)
+{
+    cv::Rect2d inter = a & b;
+    if (inter.area() <= 0) return 0.0;
+    double uni = a.area() + b.area() - inter.area();
+    return (uni > 0) ? inter.area() / uni : 0.0;
+}
+
+static SimdLevel detectSimd()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int r[4];
+    __cpuid(r, 0);
+    int maxLeaf = r[0];
+    __cpuid(r, 1);
+    bool sse2 = (r[3] & (1 << 26)) != 0;
+    bool osxsave = (r[2] & (1 << 27)) != 0;
+    bool avx = (r[2] & (1 << 28)) != 0;
+    // AVX2 also needs the OS to save the YMM state (XCR0 bits 1 and 2)
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) 
+    {
+        __cpuidex(r, 7, 0);
+        if (r[1] & (1 << 5)) return SimdLevel::AVX2;
+    }
+    if (sse2) return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel cpuSimdLevel()
+{
+    static const SimdLevel level = detectSimd();
+    return level;
+}
+
+const char* simdName(SimdLevel level)
+{
+    switch (level) 
+    {
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
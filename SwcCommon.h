@@ -0,0 +1,40 @@
+// SwcCommon.h
+// Small platform-neutral helpers shared by the Win32 UI, the analysis engine and the console front end
+// (logging sink, clocks, capture naming, rect helpers, CPU feature detection).
+//
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+// Logging: the engine never writes files itself, the front end decides where lines go.
+// Default sink writes to stderr.
+typedef void (*LogSink)(const char* s);
+void setLogSink(LogSink sink);
+void swcLog(const char* s);
+void swcLog(const std::string& s);
+
+// Monotonic milliseconds since process start (steady clock, not wall clock)
+double nowMs();
+
+// Wall clock, microseconds since the Unix epoch
+int64_t wallClockUs();
+// Wall clock time of an earlier nowMs() reading
+int64_t steadyToWallUs(double tsMs);
+
+// Local-time capture name with millisecond resolution, e.g. 20250131_142501_123.
+// Never returns the same name twice in a process: a repeat gets a _1, _2 ... suffix.
+std::string timestampFilename();
+
+// Clamp a rect to the frame, width/height never negative
+cv::Rect2d clampRect(const cv::Rect2d& r, int cols, int rows);
+
+// Intersection over union, 0 when the rects do not overlap
+double rectIoU(const cv::Rect2d& a, const cv::Rect2d& b);
+
+// Widest x86 vector extension usable at runtime (CPU and OS support), Scalar on other targets.
+// Hand-vectorized kernels dispatch on this once and keep a scalar fallback.
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+SimdLevel cpuSimdLevel();
+const char* simdName(SimdLevel level);
@@ -0,0 +1,858 @@
+// SwcEngine.cpp
+// Analysis pipeline pulled out of the WM_TIMER handler, see SwcEngine.h
+//
+
+#include "SwcEngine.h"
+#include "SwcCommon.h"
+#include "DnnPersonDetector.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+
+unique_ptr<PersonDetector> makePersonDetector(const EngineConfig& cfg)
+{
+    if (!cfg.dnnModel.empty()) 
+    {
+        DnnDetectorConfig dc;
+        dc.model = cfg.dnnModel;
+        dc.config = cfg.dnnConfig;
+        dc.inputSize = cv::Size(cfg.dnnInputSize, cfg.dnnInputSize);
+        dc.personClass = cfg.dnnPersonClass;
+        if (cfg.dnnYolo) 
+        {
+            dc.scale = 1.0 / 255.0;
+            dc.mean = cv::Scalar();
+            dc.swapRB = true;
+        }
+        auto dnn = make_unique<DnnPersonDetector>(dc);
+        if (dnn->loaded()) return dnn;
+        swcLog("DNN detector: " + dnn->error() + ", using HOG");
+    }
+    return make_unique<HogPersonDetector>(cfg.hogScale);
+}
+
+const char* motionBackendName(MotionBackend b)
+{
+    switch (b) 
+    {
+    case MotionBackend::KNN: return "knn";
+    case MotionBackend::FrameDiff: return "framediff";
+    default: return "mog2";
+    }
+}
+
+AnalysisEngine::AnalysisEngine(const EngineConfig& cfg)
+    : m_cfg(cfg)
+{
+    reset();
+}
+
+AnalysisEngine::~AnalysisEngine()
+{
+    shutdown();
+}
+
+void AnalysisEngine::configure(const EngineConfig& cfg)
+{
+    m_cfg = cfg;
+    reset();
+}
+
+void AnalysisEngine::setZones(const vector<Zone>& zones)
+{
+    m_zones.setZones(zones);
+    // the motion ROI moves with the zones, a background model of the old ROI is useless
+    createMotionModel();
+    m_grid.clear();
+}
+
+void AnalysisEngine::createMotionModel()
+{
+    m_backSub.release();
+    if (m_cfg.motionBackend == MotionBackend::MOG2) 
+        m_backSub = cv::createBackgroundSubtractorMOG2(m_cfg.bgHistory, m_cfg.bgVarThreshold, m_cfg.bgDetectShadows);
+    else if (m_cfg.motionBackend == MotionBackend::KNN) 
+        m_backSub = cv::createBackgroundSubtractorKNN(m_cfg.bgHistory, 400.0, m_cfg.bgDetectShadows);
+    FrameDiffConfig fd;
+    fd.diffThreshold = m_cfg.frameDiffThreshold;
+    fd.bgThreshold = m_cfg.frameDiffBgThreshold;
+    fd.defaultLearningRate = m_cfg.learningRate;
+    m_frameDiff = FrameDiffDetector(fd);
+}
+
+void AnalysisEngine::reset()
+{
+    // clamp the scale and shrink the 5x5 cleanup kernels with it, keeping them odd and >= 3
+    m_cfg.analysisScale = min(1.0, max(0.05, m_cfg.analysisScale));
+    m_blurSize = max(3, (int)lround(5 * m_cfg.analysisScale) | 1);
+    m_kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(m_blurSize, m_blurSize));
+    createMotionModel();
+    m_lastHogFallback = -1e18;
+    // the async detector pre-warms on its own thread as soon as it starts
+    m_async.stop();
+    m_detector = makePersonDetector(m_cfg);
+    if (m_cfg.useHog && m_cfg.asyncDetector && m_det == &m_async) m_async.start(makePersonDetector(m_cfg));
+    m_grid.configure(m_cfg.tileSize, m_cfg.tileMinPixels);
+    CadenceConfig cc;
+    cc.minInterval = m_cfg.detectInterval;
+    cc.maxInterval = m_cfg.detectMaxInterval;
+    m_sched.configure(cc);
+    m_tracks.setThreads(m_cfg.maxTracks > 1 ? m_cfg.trackThreads : 1);
+    TrackerFactoryConfig tf;
+    tf.preference.erase(remove(tf.preference.begin(), tf.preference.end(), m_cfg.tracker), tf.preference.end());
+    tf.preference.insert(tf.preference.begin(), m_cfg.tracker);
+    if (m_calibration.joinable()) m_calibration.join();
+    m_trackerFactory.configure(tf);
+    m_trackersCalibrated = m_trackerFactory.calibrated();
+    m_tracks.setFactory(&m_trackerFactory);
+    m_tracks.setPixelBudget(m_cfg.trackPixelBudget);
+    m_tracks.setTimeBudget(m_cfg.trackerBudgetMs);
+    m_reacq = ReacquireStats();
+    m_gallery.configure(max(0, m_cfg.reidGallery), m_cfg.reidMaxAgeMs);
+    stopTracking();
+}
+
+void AnalysisEngine::stopTracking()
+{
+    m_tracks.clear();
+    m_lost.clear();
+    m_bbox = cv::Rect2d();
+}
+
+EngineResult AnalysisEngine::process(const cv::Mat& frame)
+{
+    return processFrame(frame, nullptr, nowMs());
+}
+
+EngineResult AnalysisEngine::process(const FrameRef& frame, double tsMs)
+{
+    if (!frame) return EngineResult();
+    return processFrame(*frame, &frame, tsMs);
+}
+
+EngineResult AnalysisEngine::processFrame(const cv::Mat& frame, const FrameRef* ref, double tsMs)
+{
+    EngineResult res;
+    if (frame.empty()) return res;
+    double t0 = nowMs();
+    m_fgSumValid = false;
+
+    // a detector result from an earlier frame: verdict on a track or forwarded new tracks
+    if (m_det->running()) consumeDetection(tsMs, res);
+
+    // what each tracker backend costs on this machine, once, on a person-sized box. Init plus a few
+    // updates of every backend (MIL and Nano included) take hundreds of ms: they run on a copy of
+    // the frame on their own thread, choose() ranks by typical costs until the numbers are in. Started
+    // while no track is running so the timings are not taken against a busy tracker pool.
+    if (m_cfg.trackerBudgetMs > 0.0 && !m_trackersCalibrated && m_tracks.empty()) 
+    {
+        m_trackersCalibrated = true;
+        int h = frame.rows / 3;
+        double s = TrackManager::levelScale(m_tracks.levelFor(cv::Rect2d(0, 0, h / 2, h)));
+        cv::Mat f;
+        if (s < 1.0) cv::resize(frame, f, cv::Size(), s, s, cv::INTER_AREA);
+        else f = frame.clone();
+        int bh = (int)(h * s), bw = bh / 2;
+        cv::Rect box((f.cols - bw) / 2, (f.rows - bh) / 2, bw, bh);
+        m_calibration = thread([this, f, box]() { m_trackerFactory.calibrate(f, box); });
+    }
+
+    // detector frame or tracker-only frame
+    double t = nowMs();
+    res.detectorFrame = m_sched.next(frame);
+    double schedMs = nowMs() - t;
+
+    // lost tracks are looked for where they should be now before the full-frame path gets a go
+    if (!m_lost.empty()) searchLost(frame, ref, tsMs, res);
+
+    // auto init with background subtraction if enabled and a track slot is free
+    if (m_autoMode && m_lost.empty() && (int)m_tracks.size() < max(1, m_cfg.maxTracks)) 
+    {
+        if (res.detectorFrame) 
+        {
+            if (autoInit(frame, ref, tsMs, res)) res.trackerInit = true;
+            if (m_cfg.useTileGrid) res.dirtyTiles = m_grid.dirtyCount();
+            if (m_tracks.empty()) m_sched.relax();
+        }
+    }
+    else if (m_grid.cols() > 0) 
+    {
+        m_grid.clear();
+    }
+    res.times.prepare += schedMs;
+
+    // update the trackers (tracks started on this frame already saw it)
+    if (!m_tracks.empty()) updateTracks(frame, tsMs, res);
+
+    // does a tracked box still hold a person (not right after init, that candidate is verified already)
+    if (!m_tracks.empty() && res.detectorFrame && !res.trackerInit && m_cfg.useHog && m_cfg.reverifyFailures > 0) 
+        reverifyTrack(frame, ref, tsMs, res);
+    // tracks parked on static pixels
+    if (m_cfg.driftSeconds > 0.0 && !m_tracks.empty()) checkDrift(frame, tsMs, res);
+    if (res.trackerLost) 
+    {
+        m_sched.alert();
+        m_sched.wake();
+    }
+
+    if (const Track* p = m_tracks.primary()) m_bbox = p->bbox;
+    res.tracking = !m_tracks.empty();
+    res.bbox = m_bbox;
+    res.tracks = m_tracks.boxes();
+    res.times.total = nowMs() - t0;
+    return res;
+}
+
+// Apply the latest async detector result to the current frame. Verification results become a verdict
+// on the track they were submitted for; fallback detections start tracks on their source frame
+// which are then updated once on the current frame, so a late box is forwarded (and re-validated)
+// instead of being used where the person was. True when a track was started this way.
+bool AnalysisEngine::consumeDetection(double tsMs, EngineResult& res)
+{
+    DetectResult r;
+    if (!m_det->poll(r, m_channel)) return false;
+    double lag = max(0.0, tsMs - r.req.tsMs);
+    m_det->recordLag(lag);
+    res.detectLagMs = lag;
+    filterByZones(r.detections);
+
+    if (r.req.reacquire) 
+    {
+        m_reacq.scanMs += r.detectMs;
+        const cv::Mat& src = *r.req.frame;
+        if (lag <= m_cfg.maxDetectLagMs) 
+            recoverTrack(r.req.track, cv::Rect2d(r.req.candidate), r.detections, src, r.req.tsMs, false, res);
+        return false;
+    }
+    if (!r.req.candidate.empty()) 
+    {
+        bool hit = false;
+        for (auto& d : r.detections) hit = hit || rectIoU(r.req.candidate, d) > 0.2;
+        applyVerdict(r.req.track, hit, res);
+        return false;
+    }
+    if (!m_autoMode || r.detections.empty() || (int)m_tracks.size() >= max(1, m_cfg.maxTracks)) return false;
+    if (lag > m_cfg.maxDetectLagMs) 
+    {
+        ++m_staleDetections;
+        return false;
+    }
+
+    // no contour candidate: detector-only detections, largest first, each one not tracked yet
+    sort(r.detections.begin(), r.detections.end(), [](const cv::Rect& a, const cv::Rect& b) { return a.area() > b.area(); });
+    // a track started on the source frame (always an earlier one, results arrive a frame late at the
+    // soonest) is not fresh: the regular update moves it to this frame and drops it if it does not survive
+    const cv::Mat& src = *r.req.frame;
+    bool started = false;
+    for (const cv::Rect& d : r.detections) 
+    {
+        if ((int)m_tracks.size() >= max(1, m_cfg.maxTracks)) break;
+        if (m_tracks.match(cv::Rect2d(d), m_cfg.trackMatchIoU)) continue;
+        int id = startTrack(src, cv::Rect2d(d), r.req.tsMs, res, false);
+        if (id < 0) continue;
+        started = res.trackerInit = true;
+        swcLog("Auto-init: track " + to_string(id) + " initialized (async " + m_detector->name() + ", forwarded "
+            + to_string((int)lag) + " ms)");
+    }
+    return started;
+}
+
+// Run the person detector on a padded crop around one tracked box, round robin over the tracks
+// (inline, or on the async detector with the verdict arriving in consumeDetection on a later frame)
+void AnalysisEngine::reverifyTrack(const cv::Mat& frame, const FrameRef* ref, double tsMs, EngineResult& res)
+{
+    if (m_tracks.empty()) return;
+    double t = nowMs();
+    const Track& tr = m_tracks.tracks()[m_verifyCursor++ % m_tracks.size()];
+    m_zones.prepare(frame.size(), m_cfg.analysisScale);
+    DetectRequest req;
+    req.candidate = cv::Rect(tr.bbox);
+    req.track = tr.id;
+    verifyRoi(req.candidate, req.roi, req.scale);
+    if (ref && m_det->running()) 
+    {
+        req.frame = *ref;
+        req.tsMs = tsMs;
+        m_det->submit(move(req), m_channel);
+    }
+    else 
+    {
+        vector<cv::Rect> dets;
+        detectInRoi(*m_detector, frame, req.roi, req.scale, m_detectBuf, dets);
+        filterByZones(dets);
+        bool hit = false;
+        for (auto& d : dets) hit = hit || rectIoU(req.candidate, d) > 0.2;
+        applyVerdict(req.track, hit, res);
+    }
+    res.times.hog += nowMs() - t;
+}
+
+// Detector verdict on a track: a confirmed track relaxes the cadence, a miss tightens it, and
+// reverifyFailures misses in a row drop the track (CSRT happily follows a background patch)
+void AnalysisEngine::applyVerdict(int trackId, bool hit, EngineResult& res)
+{
+    Track* tr = m_tracks.find(trackId);
+    if (!tr) return;
+    res.verified = hit ? 1 : -1;
+    if (hit) 
+    {
+        tr->verifyMisses = 0;
+        m_sched.relax();
+        return;
+    }
+    m_sched.alert();
+    if (m_cfg.reverifyFailures > 0 && ++tr->verifyMisses >= m_cfg.reverifyFailures) 
+    {
+        swcLog("Track " + to_string(trackId) + " not confirmed by the detector " + to_string(tr->verifyMisses)
+            + " times -> released");
+        m_tracks.retire(trackId);
+        res.trackerLost = true;
+    }
+}
+
+// Queue a lost track for the predicted-window search and remember its appearance (not when it was
+// released for failing re-verification: the detector said there was nobody there)
+void AnalysisEngine::trackLost(Track& t, double tsMs)
+{
+    if (m_gallery.capacity() > 0) m_gallery.add(t.id, t.appearance, tsMs);
+    if (m_cfg.reacquireFrames <= 0 || !m_cfg.useHog || !t.motion.initialized()) return;
+    LostTrack l;
+    l.id = t.id;
+    l.motion = move(t.motion);
+    l.motion.predict(); // to this frame, the tracker's box of it is no good
+    m_lost.push_back(move(l));
+    ++m_reacq.losses;
+}
+
+// Advance the prediction of every lost track and run the detector on its search window: all of
+// them inline, one per frame (round robin) on the async detector. Tracks not found within
+// reacquireFrames are given up on, auto-init takes over.
+void AnalysisEngine::searchLost(const cv::Mat& frame, const FrameRef* ref, double tsMs, EngineResult& res)
+{
+    double t = nowMs();
+    size_t kept = 0;
+    for (size_t i = 0; i < m_lost.size(); ++i) 
+    {
+        LostTrack& l = m_lost[i];
+        l.motion.predict();
+        if (++l.frames > m_cfg.reacquireFrames) 
+        {
+            ++m_reacq.escalated;
+            swcLog("Track " + to_string(l.id) + ": not found near its predicted position in "
+                + to_string(m_cfg.reacquireFrames) + " frames -> full-frame detection");
+            m_sched.wake();
+            continue;
+        }
+        if (kept != i) m_lost[kept] = move(m_lost[i]);
+        ++kept;
+    }
+    m_lost.resize(kept);
+    if (m_lost.empty()) return;
+
+    m_zones.prepare(frame.size(), m_cfg.analysisScale);
+    auto request = [&](const LostTrack& l) 
+    {
+        DetectRequest req;
+        req.candidate = cv::Rect(l.motion.box());
+        req.track = l.id;
+        req.reacquire = true;
+        searchRoi(cv::Rect(l.motion.searchWindow(m_cfg.reacquireSigmas)), req.candidate.height, req.roi, req.scale);
+        return req;
+    };
+    if (ref && m_det->running()) 
+    {
+        if (!m_det->busy(m_channel)) 
+        {
+            DetectRequest req = request(m_lost[m_lostCursor++ % m_lost.size()]);
+            if (req.roi.area() > 0) 
+            {
+                req.frame = *ref;
+                req.tsMs = tsMs;
+                ++m_reacq.scans;
+                m_det->submit(move(req), m_channel);
+            }
+        }
+    }
+    else 
+    {
+        for (size_t i = 0; i < m_lost.size();) 
+        {
+            DetectRequest req = request(m_lost[i]);
+            vector<cv::Rect> dets;
+            if (req.roi.area() > 0) 
+            {
+                double ts = nowMs();
+                detectInRoi(*m_detector, frame, req.roi, req.scale, m_detectBuf, dets);
+                m_reacq.scanMs += nowMs() - ts;
+                ++m_reacq.scans;
+                filterByZones(dets);
+            }
+            // a recovered track leaves m_lost
+            if (!recoverTrack(req.track, cv::Rect2d(req.candidate), dets, frame, tsMs, true, res)) ++i;
+        }
+    }
+    res.times.hog += nowMs() - t;
+}
+
+// Restart lost track id on the detection closest to where it was predicted (similar size, not
+// someone already tracked), on src (the frame the detector ran on). True when it was found.
+bool AnalysisEngine::recoverTrack(int id, const cv::Rect2d& predicted, const vector<cv::Rect>& dets, const cv::Mat& src,
+                                  double srcTs, bool fresh, EngineResult& res)
+{
+    auto it = find_if(m_lost.begin(), m_lost.end(), [id](const LostTrack& l) { return l.id == id; });
+    if (it == m_lost.end() || (int)m_tracks.size() >= max(1, m_cfg.maxTracks)) return false;
+    cv::Point2d pc(predicted.x + predicted.width / 2.0, predicted.y + predicted.height / 2.0);
+    const cv::Rect* best = nullptr;
+    double bestDist = 0.0;
+    for (const cv::Rect& d : dets) 
+    {
+        double hr = d.height / max(1.0, predicted.height);
+        if (hr < 0.5 || hr > 2.0 || m_tracks.match(cv::Rect2d(d), m_cfg.trackMatchIoU)) continue;
+        double dist = cv::norm(cv::Point2d(d.x + d.width / 2.0, d.y + d.height / 2.0) - pc);
+        if (!best || dist < bestDist) 
+        {
+            best = &d;
+            bestDist = dist;
+        }
+    }
+    if (!best || m_tracks.spawn(src, cv::Rect2d(*best), srcTs, fresh, id) < 0) return false;
+    // carry on with the velocity estimate
+    if (Track* tr = m_tracks.find(id)) 
+    {
+        tr->motion = move(it->motion);
+        tr->motion.correct(tr->bbox);
+        computeAppearance(src, cv::Rect(tr->bbox), tr->appearance);
+    }
+    m_gallery.remove(id);
+    ++m_reacq.recovered;
+    m_reacq.recoverFrames += it->frames;
+    swcLog("Track " + to_string(id) + ": re-acquired near its predicted position after " + to_string(it->frames) + " frames");
+    m_lost.erase(it);
+    res.reacquired = true;
+    return true;
+}
+
+// Share of foreground pixels in every track box: four lookups in the integral image of the motion
+// mask per track, smoothed over the checks. A track whose share stays under driftMinShare for
+// driftSeconds follows something that does not move and is released (not re-acquired: there was
+// nobody to lose).
+void AnalysisEngine::checkDrift(const cv::Mat& frame, double tsMs, EngineResult& res)
+{
+    if (!m_fgSumValid) 
+    {
+        // no auto-init motion pass this frame: one of our own now and then
+        if (++m_driftTick < max(1, m_cfg.driftCheckFrames)) return;
+        cv::Mat fg;
+        if (!foreground(frame, fg, res.times)) return;
+    }
+    m_driftTick = 0;
+    double t = nowMs();
+    double s = m_cfg.analysisScale;
+    cv::Rect maskRect(0, 0, m_fgSum.cols - 1, m_fgSum.rows - 1);
+    vector<int> drifted;
+    for (const TrackBox& b : m_tracks.boxes()) 
+    {
+        cv::Rect r = cv::Rect(cv::Point((int)floor(b.bbox.x * s), (int)floor(b.bbox.y * s)),
+                              cv::Point((int)ceil((b.bbox.x + b.bbox.width) * s), (int)ceil((b.bbox.y + b.bbox.height) * s)))
+            - m_motionRoi.tl();
+        cv::Rect in = r & maskRect;
+        // mostly outside the watched area: no evidence either way
+        if (r.area() <= 0 || in.area() < r.area() / 4) continue;
+        const int* top = m_fgSum.ptr<int>(in.y);
+        const int* bottom = m_fgSum.ptr<int>(in.y + in.height);
+        double fgSum = (double)bottom[in.x + in.width] - bottom[in.x] - top[in.x + in.width] + top[in.x];
+        double share = fgSum / in.area();
+
+        Track* tr = m_tracks.find(b.id);
+        tr->motionShare = tr->motionShare < 0 ? share : tr->motionShare + 0.3 * (share - tr->motionShare);
+        if (tr->motionShare >= m_cfg.driftMinShare) tr->staticSinceMs = -1.0;
+        else if (tr->staticSinceMs < 0) tr->staticSinceMs = tsMs;
+        else if (tsMs - tr->staticSinceMs >= m_cfg.driftSeconds * 1000.0) drifted.push_back(b.id);
+    }
+    for (int id : drifted) 
+    {
+        ostringstream msg;
+        msg << "Track " << id << ": on static pixels for " << fixed << setprecision(0) << m_cfg.driftSeconds
+            << " s (foreground share " << setprecision(1) << m_tracks.find(id)->motionShare * 100.0 << "%) -> drifted, released";
+        swcLog(msg.str());
+        m_tracks.retire(id);
+        ++m_driftReleases;
+        res.trackerLost = true;
+    }
+    res.times.tracker += nowMs() - t;
+}
+
+bool AnalysisEngine::validTrackBox(const cv::Rect2d& box, const cv::Mat& frame) const
+{
+    double area = box.width * box.height;
+    double frameA = double(frame.cols) * double(frame.rows);
+    return box.width > 1.0 && box.height > 1.0 && area >= m_cfg.minTrackArea && area <= m_cfg.maxTrackAreaRatio * frameA;
+}
+
+void AnalysisEngine::shareDetector(AsyncDetector* shared)
+{
+    if (shared == m_det || (!shared && m_det == &m_async)) return;
+    m_async.stop();
+    m_det = shared ? shared : &m_async;
+    m_channel = shared ? shared->addChannel() : 0;
+    if (!shared && m_cfg.useHog && m_cfg.asyncDetector) m_async.start(makePersonDetector(m_cfg));
+}
+
+AsyncDetectorStats AnalysisEngine::detectorStats() const
+{
+    return m_det->stats();
+}
+
+void AnalysisEngine::shutdown()
+{
+    m_async.stop();
+    if (m_calibration.joinable()) m_calibration.join();
+}
+
+// Motion stage: foreground mask of the analysis frame inside the zones' bounding rect (m_motionRoi,
+// analysis coords). Its integral image is kept for the drift check. False when the zones leave
+// nothing to look at.
+bool AnalysisEngine::foreground(const cv::Mat& frame, cv::Mat& fg, StageTimes& st)
+{
+    double t = nowMs();
+    const cv::Mat& motion = motionFrame(frame);
+    // hotspot zones: all per-pixel work stays inside the bounding rect of the allowed area
+    m_zones.prepare(frame.size(), m_cfg.analysisScale);
+    cv::Rect motionRect(0, 0, motion.cols, motion.rows);
+    m_motionRoi = m_zones.restricted() ? (m_zones.roi() & motionRect) : motionRect;
+    st.prepare += nowMs() - t;
+    if (m_motionRoi.area() <= 0) return false;
+
+    t = nowMs();
+    cv::Mat motionIn = motion(m_motionRoi);
+    // apply background subtractor (tune learning rate if needed)
+    if (m_backSub) m_backSub->apply(motionIn, fg, m_cfg.learningRate);
+    else m_frameDiff.apply(motionIn, fg, m_cfg.learningRate);
+    // polygon zones that do not fill their bounding rect
+    const cv::Mat& zoneMask = m_zones.roiMask();
+    if (!zoneMask.empty() && zoneMask.size() == fg.size()) cv::bitwise_and(fg, zoneMask, fg);
+    if (m_cfg.driftSeconds > 0.0) 
+    {
+        // real motion only: MOG2/KNN mark shadows 127, a track standing in its own shadow is not moving
+        cv::threshold(fg, m_fgBin, 200, 1, cv::THRESH_BINARY);
+        cv::integral(m_fgBin, m_fgSum, CV_32S);
+        m_fgSumValid = true;
+    }
+    st.motion += nowMs() - t;
+    return true;
+}
+
+// Frame the motion path runs on: resized first (INTER_AREA), then converted, so the
+// color conversion only touches the small image
+const cv::Mat& AnalysisEngine::motionFrame(const cv::Mat& frame)
+{
+    const cv::Mat* src = &frame;
+    if (m_cfg.analysisScale < 1.0) 
+    {
+        cv::resize(frame, m_small, cv::Size(), m_cfg.analysisScale, m_cfg.analysisScale, cv::INTER_AREA);
+        src = &m_small;
+    }
+    if (m_cfg.analysisGray && src->channels() == 3) 
+    {
+        cv::cvtColor(*src, m_gray, cv::COLOR_BGR2GRAY);
+        src = &m_gray;
+    }
+    return *src;
+}
+
+// Morphological cleanup and external contours of one mask (or region, contours offset into
+// analysis coords), stage times accumulate over the regions of a frame
+void AnalysisEngine::extractContours(cv::Mat& fg, cv::Point offset, vector<vector<cv::Point>>& contours, StageTimes& st)
+{
+    // morphological cleanup: remove noise and fill holes
+    double t = nowMs();
+    cv::morphologyEx(fg, fg, cv::MORPH_OPEN, m_kernel, cv::Point(-1, -1), 1);
+    cv::morphologyEx(fg, fg, cv::MORPH_CLOSE, m_kernel, cv::Point(-1, -1), 2);
+    cv::medianBlur(fg, fg, m_blurSize);
+    st.morphology += nowMs() - t;
+
+    // find contours
+    t = nowMs();
+    vector<vector<cv::Point>> found;
+    cv::findContours(fg, found, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, offset);
+    for (auto& c : found) contours.push_back(move(c));
+    st.contours += nowMs() - t;
+}
+
+// Detector input for verifying a candidate: a padded crop around it, resized so the candidate is
+// hogTargetHeight px tall. The HOG pyramid then starts near the person's own size instead of at
+// 64x128 over the whole frame.
+void AnalysisEngine::verifyRoi(const cv::Rect& cand, cv::Rect& roi, double& scale) const
+{
+    int padX = (int)lround(cand.width * m_cfg.hogPadding);
+    int padY = (int)lround(cand.height * m_cfg.hogPadding);
+    searchRoi(cv::Rect(cand.x - padX, cand.y - padY, cand.width + 2 * padX, cand.height + 2 * padY), cand.height, roi, scale);
+}
+
+// Detector crop for window (clipped to the zones) scaled so a person personHeight px tall comes
+// out hogTargetHeight px tall
+void AnalysisEngine::searchRoi(const cv::Rect& window, int personHeight, cv::Rect& roi, double& scale) const
+{
+    roi = window & m_zones.fullRoi();
+    scale = personHeight > 0 ? m_cfg.hogTargetHeight / (double)personHeight : 1.0;
+    // small candidates are upscaled at most 2x, the crop must still fit the 64x128 window
+    scale = min(2.0, scale);
+    scale = max(scale, max(64.0 / max(1, roi.width), 128.0 / max(1, roi.height)));
+}
+
+// Drop detections whose centre is outside the hotspot zones
+void AnalysisEngine::filterByZones(vector<cv::Rect>& dets) const
+{
+    size_t kept = 0;
+    for (auto& d : dets) 
+    {
+        if (m_zones.accepts(cv::Point2d(d.x + d.width / 2.0, d.y + d.height / 2.0))) dets[kept++] = d;
+    }
+    dets.resize(kept);
+}
+
+bool AnalysisEngine::autoInit(const cv::Mat& frame, const FrameRef* ref, double tsMs, EngineResult& res)
+{
+    StageTimes& st = res.times;
+    cv::Mat fg;
+    if (!foreground(frame, fg, st)) return false;
+    cv::Point roiOffset = m_motionRoi.tl();
+
+    double t;
+    vector<vector<cv::Point>> contours;
+    if (m_cfg.useTileGrid) 
+    {
+        // activity grid: nothing changed -> no cleanup, no contours, no HOG fallback
+        t = nowMs();
+        m_grid.update(fg);
+        st.grid = nowMs() - t;
+        if (m_grid.quiet()) return false;
+        for (const cv::Rect& r : m_grid.regions()) 
+        {
+            fg(r).copyTo(m_region);
+            extractContours(m_region, r.tl() + roiOffset, contours, st);
+        }
+    }
+    else 
+    {
+        extractContours(fg, roiOffset, contours, st);
+    }
+
+    t = nowMs();
+
+    double minArea = max(m_cfg.minContourArea, 500.0);
+    double frameA = (double)(frame.cols * frame.rows);
+    double diag = sqrt(frame.cols * frame.cols + frame.rows * frame.rows);
+
+    // viable candidates not followed by a track yet, (score, full-res rect)
+    vector<pair<double, cv::Rect>> cands;
+
+    // compute center preference (prefer blobs near previous track or center)
+    cv::Point2d prefCenter(frame.cols / 2.0, frame.rows / 2.0);
+    if (!m_bbox.empty()) prefCenter = cv::Point2d(m_bbox.x + m_bbox.width / 2.0, m_bbox.y + m_bbox.height / 2.0);
+
+    // contour geometry is in analysis coords, areas and rects are scaled back to the full frame
+    double inv = 1.0 / m_cfg.analysisScale;
+    for (auto& c : contours) 
+    {
+        double area = cv::contourArea(c) * inv * inv;
+        if (area < minArea) continue;
+
+        cv::Rect r = cv::boundingRect(c);
+        if (inv != 1.0) 
+        {
+            r = cv::Rect(cv::Point((int)floor(r.x * inv), (int)floor(r.y * inv)),
+                         cv::Point((int)ceil((r.x + r.width) * inv), (int)ceil((r.y + r.height) * inv)))
+                & cv::Rect(0, 0, frame.cols, frame.rows);
+            if (r.area() <= 0) continue;
+        }
+        double areaRatio = area / frameA;
+        if (areaRatio > m_cfg.maxAreaRatio) continue;
+
+        double aspect = (r.height > 0) ? (double)r.height / (double)r.width : 0.0;
+        if (aspect < m_cfg.minAspect || aspect > m_cfg.maxAspect) continue;
+
+        // compute solidity
+        vector<cv::Point> hull;
+        cv::convexHull(c, hull);
+        double hullArea = cv::contourArea(hull) * inv * inv;
+        double solidity = (hullArea > 1e-6) ? (area / hullArea) : 0.0;
+        if (solidity < m_cfg.minSolidity) 
+        {
+            ++res.solidityRejected;
+            continue;
+        }
+
+        // candidate centre must lie inside the hotspot zones
+        cv::Point2d cpos(r.x + r.width / 2.0, r.y + r.height / 2.0);
+        if (!m_zones.accepts(cpos)) continue;
+
+        // a person who is already tracked
+        if (m_tracks.match(cv::Rect2d(r), m_cfg.trackMatchIoU)) continue;
+
+        // scoring: prefer larger area and closeness to preferred center
+        double dist = cv::norm(cpos - prefCenter);
+        double distScore = 1.0 - min(1.0, dist / diag);
+
+        // score = weighted combination
+        double score = 0.6 * areaRatio + 0.4 * distScore;
+        cands.emplace_back(score, r);
+    }
+    sort(cands.begin(), cands.end(), [](const pair<double, cv::Rect>& a, const pair<double, cv::Rect>& b) { return a.first > b.first; });
+    st.contours += nowMs() - t;
+
+    // HOG person detector check. The best contour candidate is verified on a padded crop around it;
+    // without one the zone-wide fallback runs on a throttled schedule. Async: both go to the detector
+    // thread and come back on a later frame (consumeDetection), the contour candidate does not wait.
+    int verifyId = 0;
+    if (m_cfg.useHog)
+    {
+        t = nowMs();
+        bool async = ref && m_det->running();
+        bool fallbackDue = cands.empty() && m_cfg.hogFallbackIntervalMs >= 0 &&
+            t - m_lastHogFallback >= m_cfg.hogFallbackIntervalMs;
+        DetectRequest req;
+        if (!cands.empty()) 
+        {
+            verifyRoi(cands[0].second, req.roi, req.scale);
+            req.candidate = cands[0].second;
+            req.track = m_tracks.nextId(); // the track this candidate is about to start
+        }
+        else if (fallbackDue && !(async && m_det->busy(m_channel))) 
+        {
+            m_lastHogFallback = t;
+            req.roi = m_zones.fullRoi();
+        }
+
+        bool haveWork = req.roi.area() > 0;
+        if (haveWork && async) 
+        {
+            req.frame = *ref;
+            req.tsMs = tsMs;
+            verifyId = req.track;
+            m_det->submit(move(req), m_channel);
+        }
+        else if (haveWork) 
+        {
+            vector<cv::Rect> hogDet;
+            detectInRoi(*m_detector, frame, req.roi, req.scale, m_detectBuf, hogDet);
+            filterByZones(hogDet);
+            if (cands.empty()) 
+            {
+                // no contour candidate: fallback to HOG-only detections not tracked yet, largest first
+                sort(hogDet.begin(), hogDet.end(), [](const cv::Rect& a, const cv::Rect& b) { return a.area() > b.area(); });
+                for (auto& hr : hogDet) 
+                {
+                    if (hr.area() > 0 && !m_tracks.match(cv::Rect2d(hr), m_cfg.trackMatchIoU)) cands.emplace_back(0.5, hr);
+                }
+            }
+            else 
+            {
+                // contour candidate: boost confidence if some HOG detection overlaps
+                for (auto& hr : hogDet) 
+                {
+                    if (rectIoU(cands[0].second, hr) > 0.2) { cands[0].first += 0.3; break; }
+                }
+            }
+        }
+        st.hog = nowMs() - t;
+    }
+
+    // start a track for each viable candidate, best first, while slots are free
+    bool started = false;
+    for (size_t i = 0; i < cands.size() && (int)m_tracks.size() < max(1, m_cfg.maxTracks); ++i) 
+    {
+        const cv::Rect& r = cands[i].second;
+        int id = startTrack(frame, cv::Rect2d(r.x, r.y, r.width, r.height), tsMs, res);
+        // the pending verdict must not land on the next track (none came of it, or a lost id came back)
+        if (i == 0 && verifyId > 0 && id != verifyId) m_tracks.reserveId();
+        if (id < 0) 
+        {
+            swcLog("Auto-init: tracker init failed");
+            continue;
+        }
+        started = true;
+        swcLog("Auto-init: track " + to_string(id) + " initialized (contour/HOG)");
+    }
+    return started;
+}
+
+// New track on frame, its id or -1 if the tracker could not be initialised. A person who looks
+// like a recently lost track gets that track's id back.
+int AnalysisEngine::startTrack(const cv::Mat& frame, const cv::Rect2d& r, double tsMs, EngineResult& res, bool fresh)
+{
+    AppearanceDescriptor look;
+    int reid = 0;
+    float sim = 0.0f;
+    if (m_gallery.capacity() > 0 && computeAppearance(frame, cv::Rect(r), look)) 
+        reid = m_gallery.match(look, tsMs, (float)m_cfg.reidMinSimilarity, &sim);
+    int id = m_tracks.spawn(frame, r, tsMs, fresh, reid);
+    if (id < 0) return -1;
+    m_tracks.find(id)->appearance = look;
+    if (reid > 0) 
+    {
+        m_gallery.remove(reid);
+        m_lost.erase(remove_if(m_lost.begin(), m_lost.end(), [reid](const LostTrack& l) { return l.id == reid; }), m_lost.end());
+        res.reidentified = reid;
+        ostringstream msg;
+        msg << "Track " << reid << ": re-identified by appearance (similarity " << fixed << setprecision(2) << sim << ")";
+        swcLog(msg.str());
+    }
+    if (m_tracks.size() == 1) m_bbox = m_tracks.primary()->bbox;
+    return id;
+}
+
+bool AnalysisEngine::startTracking(const cv::Mat& frame, const cv::Rect2d& r)
+{
+    if (frame.empty()) return false;
+    stopTracking();
+    EngineResult res;
+    // not fresh: the selection frame is already behind, the next process() moves the track onto its frame
+    return startTrack(frame, r, nowMs(), res, false) >= 0;
+}
+
+void AnalysisEngine::updateTracks(const cv::Mat& frame, double tsMs, EngineResult& res)
+{
+    double t = nowMs();
+    vector<Track> lost;
+    m_tracks.update(frame, lost);
+    for (Track& tr : lost) 
+    {
+        res.trackerLost = true;
+        swcLog("Track " + to_string(tr.id) + ": tracker update failed -> released");
+        trackLost(tr, tsMs);
+    }
+
+    // sanity checks
+    vector<int> invalid;
+    for (const Track& tr : m_tracks.tracks()) 
+    {
+        if (!validTrackBox(tr.bbox, frame)) invalid.push_back(tr.id);
+    }
+    for (int id : invalid) 
+    {
+        Track tr;
+        m_tracks.retire(id, &tr);
+        res.trackerLost = true;
+        swcLog("Track " + to_string(id) + ": tracker produced invalid bbox -> lost");
+        trackLost(tr, tsMs);
+    }
+
+    // the surviving boxes feed the motion predictors
+    for (const TrackBox& b : m_tracks.boxes()) 
+    {
+        Track* tr = m_tracks.find(b.id);
+        tr->motion.predict();
+        tr->motion.correct(b.bbox);
+    }
+    // appearance of one track per frame: a few tens of microseconds, follows lighting and pose
+    if (m_gallery.capacity() > 0 && !m_tracks.empty()) 
+    {
+        Track* tr = m_tracks.find(m_tracks.tracks()[m_appearanceCursor++ % m_tracks.size()].id);
+        AppearanceDescriptor look;
+        if (computeAppearance(frame, cv::Rect(tr->bbox), look)) blendAppearance(tr->appearance, look, 0.2f);
+    }
+    res.times.tracker = nowMs() - t;
+}
@@ -0,0 +1,281 @@
+// SwcEngine.h
+// Platform-neutral analysis engine: motion auto-init (MOG2, KNN or SIMD frame differencing, then
+// morphology, contour scoring, HOG check, all restricted to the hotspot zones)
+// followed by the tracker updates of up to maxTracks simultaneous tracks. No Win32 or camera dependency, the caller feeds BGR frames.
+// Used by the Win32 UI (SecurityWebCam.cpp) and the console front end (SwcCli.cpp).
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "FrameDiffDetector.h"
+#include "MotionGrid.h"
+#include "HotspotZones.h"
+#include "PersonDetector.h"
+#include "AsyncDetector.h"
+#include "DetectScheduler.h"
+#include "TrackManager.h"
+#include "FramePool.h"
+#include "TrackerFactory.h"
+
+// Motion stage backend, all produce a CV_8UC1 foreground mask
+enum class MotionBackend
+{
+    MOG2,      // Gaussian mixture, shadow aware, the most expensive
+    KNN,
+    FrameDiff  // three-frame differencing + running average, for static indoor cameras
+};
+const char* motionBackendName(MotionBackend b);
+
+struct EngineConfig
+{
+    MotionBackend motionBackend = MotionBackend::MOG2;
+
+    // MOG2 / KNN background model
+    int bgHistory = 500;
+    double bgVarThreshold = 16.0;
+    bool bgDetectShadows = true;
+    double learningRate = 0.01;  // small learning rate to adapt slowly
+
+    // FrameDiff thresholds (luma levels)
+    int frameDiffThreshold = 15;
+    int frameDiffBgThreshold = 30;
+
+    // motion path (MOG2, morphology, contours) resolution; candidates are mapped back to
+    // full-resolution coords before scoring, HOG and the tracker still see the full frame
+    double analysisScale = 1.0;    // e.g. 0.5 or 0.25
+    bool analysisGray = false;     // feed MOG2 luma instead of BGR
+
+    // activity grid (analysis pixels): cleanup and contours only around dirty tiles,
+    // a quiet frame skips cleanup, contours and HOG altogether
+    bool useTileGrid = true;
+    int tileSize = 16;
+    int tileMinPixels = 8;        // changed pixels that make a tile dirty
+
+    // candidate selection parameters (tune these for your scene)
+    double minContourArea = 500.0; // minimal moving area
+    double maxAreaRatio = 0.9;     // ignore blobs covering almost whole frame
+    double minAspect = 1.0;        // height/width ratio lower bound for standing person
+    double maxAspect = 5.0;        // reasonable person aspect upper bound
+    double minSolidity = 0.4;      // area / convexHull area (people tend to have decent solidity)
+
+    // HOG person detector check
+    bool useHog = true;
+    double hogScale = 1.05;
+    double hogPadding = 0.5;           // verification crop = candidate grown by this fraction per side
+    int hogTargetHeight = 160;         // candidate height the crop is resized to (window is 64x128)
+    double hogFallbackIntervalMs = 1000.0; // zone-wide HOG without a contour candidate, 0 = every frame, < 0 = never
+    bool asyncDetector = false;        // HOG on its own thread, needs process(FrameRef, tsMs)
+    double maxDetectLagMs = 1500.0;    // async results older than this are not forwarded
+    // Detection cadence (DetectScheduler.h): auto-init and track re-verification run every
+    // detectInterval frames, stretched up to detectMaxInterval while the scene is calm; the frames
+    // in between only update the tracker. 1 / 1 = every frame.
+    int detectInterval = 1;
+    int detectMaxInterval = 1;
+    int reverifyFailures = 0;          // re-verify the track on detector frames, drop it after this many misses in a row (0 = off)
+    // cv::dnn person detector instead of HOG (see DnnPersonDetector.h), empty = HOG.
+    // Falls back to HOG when the model cannot be loaded.
+    std::string dnnModel;
+    std::string dnnConfig;
+    int dnnInputSize = 300;            // square network input (300 MobileNet-SSD, 640 YOLO)
+    int dnnPersonClass = 15;           // 15 VOC (MobileNet-SSD), 0 COCO (YOLO)
+    bool dnnYolo = false;              // YOLO input (RGB, 0..1) instead of SSD (BGR, -1..1)
+
+    // Simultaneous tracks (TrackManager.h): auto-init keeps looking for new people while fewer are
+    // tracked; a candidate overlapping a track by trackMatchIoU is that track. 1 = single target.
+    int maxTracks = 1;
+    double trackMatchIoU = 0.3;
+    int trackThreads = 0;              // parallel tracker updates, 0 = one per core
+    double trackPixelBudget = 0.0;     // trackers run on a frame scaled so the target is about this many px, 0 = full res
+    TrackerBackend tracker = TrackerBackend::CSRT; // preferred backend, the others follow in TrackerFactoryConfig order
+    double trackerBudgetMs = 0.0;      // per-frame tracker update budget: tracks over their share get a cheaper backend, 0 = off
+    // Re-acquisition: after a tracker loss the detector only scans a window around the track's
+    // constant-velocity prediction (BoxPredictor.h, grown by reacquireSigmas standard deviations)
+    // for up to reacquireFrames frames; auto-init takes over after that. 0 = straight to auto-init.
+    int reacquireFrames = 0;
+    double reacquireSigmas = 3.0;
+    // Re-identification (AppearanceGallery.h): lost tracks' appearance is kept for reidMaxAgeMs in a
+    // gallery of reidGallery entries; a new track that looks like one of them by reidMinSimilarity
+    // gets its id back. 0 = off.
+    int reidGallery = 0;
+    double reidMaxAgeMs = 10000.0;
+    double reidMinSimilarity = 0.85;
+    // Drift check: share of motion-mask pixels inside each track box, from the integral image of the
+    // foreground (auto-init's motion pass, or one of its own every driftCheckFrames frames while no
+    // auto-init runs). A track under driftMinShare for driftSeconds sits on static background
+    // (CSRT locked onto a patch of wall) and is released. 0 = off.
+    double driftSeconds = 0.0;
+    double driftMinShare = 0.02;
+    int driftCheckFrames = 5;
+
+    // tracker bbox sanity checks
+    double maxTrackAreaRatio = 0.95;
+    double minTrackArea = 16.0;
+};
+
+// Per-stage wall time of one process() call in ms, zero for stages that did not run
+struct StageTimes
+{
+    double prepare = 0.0; // downscale / grayscale conversion for the motion path
+    double motion = 0.0;
+    double grid = 0.0;
+    double morphology = 0.0;
+    double contours = 0.0;
+    double hog = 0.0;
+    double tracker = 0.0;
+    double total = 0.0;
+};
+
+struct EngineResult
+{
+    bool tracking = false;
+    cv::Rect2d bbox;          // primary (oldest) track
+    std::vector<TrackBox> tracks; // every track after this frame
+    bool trackerInit = false; // auto-init started a new track on this frame
+    bool trackerLost = false; // a tracker failed, produced an invalid bbox or was not confirmed on this frame
+    int dirtyTiles = -1;      // activity grid tiles that changed, -1 when the grid did not run
+    int verified = 0;         // detector verdict on a track (init candidate or re-verification): 1 person, -1 none
+    bool detectorFrame = false; // the cadence scheduler ran the detection path on this frame
+    double detectLagMs = -1.0; // an async detector result was applied, this far behind its frame
+    bool reacquired = false;  // a lost track was found again near its predicted position (same id)
+    int reidentified = 0;     // id a new track got back from the appearance gallery, 0 = none
+    int solidityRejected = 0; // auto-init contours that passed area and aspect but not minSolidity
+    StageTimes times;
+};
+
+struct ReacquireStats
+{
+    uint64_t losses = 0;        // lost tracks searched for around their prediction
+    uint64_t recovered = 0;     // found again in the window
+    uint64_t escalated = 0;     // not found in reacquireFrames, left to auto-init
+    uint64_t recoverFrames = 0; // frames from loss to recovery, summed over the recovered ones
+    uint64_t scans = 0;         // window detections
+    double scanMs = 0.0;        // detector time spent on them
+};
+
+// Person detector selected by cfg (DNN when dnnModel loads, HOG otherwise)
+std::unique_ptr<PersonDetector> makePersonDetector(const EngineConfig& cfg);
+
+class AnalysisEngine
+{
+public:
+    explicit AnalysisEngine(const EngineConfig& cfg = EngineConfig());
+    ~AnalysisEngine();
+    AnalysisEngine(const AnalysisEngine&) = delete;
+    AnalysisEngine& operator=(const AnalysisEngine&) = delete;
+
+    // Drop the background model and any running track (call on camera start)
+    void reset();
+    // Replace the configuration, implies reset()
+    void configure(const EngineConfig& cfg);
+
+    // Run one frame through auto-init (if enabled and not tracking) and the tracker update.
+    // The FrameRef overload lets the async detector keep the frame; the Mat one detects inline.
+    EngineResult process(const cv::Mat& frame);
+    EngineResult process(const FrameRef& frame, double tsMs);
+
+    // Seed a single track from a user selection in image coords (drops the others), false if init failed
+    bool startTracking(const cv::Mat& frame, const cv::Rect2d& r);
+    // Drop every track
+    void stopTracking();
+
+    void setAutoMode(bool on) { m_autoMode = on; }
+    bool autoMode() const { return m_autoMode; }
+    bool tracking() const { return !m_tracks.empty(); }
+    // Box of the primary (oldest) track, the last one is kept after it is lost
+    cv::Rect2d bbox() const { return m_bbox; }
+    const TrackManager& tracks() const { return m_tracks; }
+    const TrackerFactory& trackerFactory() const { return m_trackerFactory; }
+    const EngineConfig& config() const { return m_cfg; }
+    // Activity grid of the last detector frame (empty while tracking or not in auto mode), in analysis coords
+    // (scale by 1 / analysisScale) relative to motionRoi()
+    const MotionGrid& grid() const { return m_grid; }
+    // Part of the analysis frame the motion path ran on (zone bounding rect)
+    cv::Rect motionRoi() const { return m_motionRoi; }
+
+    // Hotspot zones in image coords, kept across reset(); changing them restarts the background model
+    void setZones(const std::vector<Zone>& zones);
+    const std::vector<Zone>& zones() const { return m_zones.zones(); }
+
+    // Send async detections to a detector shared with other engines (one channel each, pending
+    // requests of all cameras are batched). nullptr = own detector. The shared one must be started
+    // by the caller and outlive the engine.
+    void shareDetector(AsyncDetector* shared);
+    AsyncDetectorStats detectorStats() const;
+    uint64_t staleDetections() const { return m_staleDetections; }
+    const DetectScheduler& scheduler() const { return m_sched; }
+    const ReacquireStats& reacquireStats() const { return m_reacq; }
+    const AppearanceGallery& gallery() const { return m_gallery; }
+    // Tracks released for sitting on static pixels
+    uint64_t driftReleases() const { return m_driftReleases; }
+    // Stop the async detector thread (call on camera stop, restarted by configure/reset)
+    void shutdown();
+
+private:
+    EngineResult processFrame(const cv::Mat& frame, const FrameRef* ref, double tsMs);
+    bool autoInit(const cv::Mat& frame, const FrameRef* ref, double tsMs, EngineResult& res);
+    bool consumeDetection(double tsMs, EngineResult& res);
+    void reverifyTrack(const cv::Mat& frame, const FrameRef* ref, double tsMs, EngineResult& res);
+    void applyVerdict(int trackId, bool hit, EngineResult& res);
+    void trackLost(Track& t, double tsMs);
+    void searchLost(const cv::Mat& frame, const FrameRef* ref, double tsMs, EngineResult& res);
+    bool recoverTrack(int id, const cv::Rect2d& predicted, const std::vector<cv::Rect>& dets, const cv::Mat& src,
+                      double srcTs, bool fresh, EngineResult& res);
+    bool validTrackBox(const cv::Rect2d& box, const cv::Mat& frame) const;
+    void createMotionModel();
+    void verifyRoi(const cv::Rect& cand, cv::Rect& roi, double& scale) const;
+    void searchRoi(const cv::Rect& window, int personHeight, cv::Rect& roi, double& scale) const;
+    void filterByZones(std::vector<cv::Rect>& dets) const;
+    const cv::Mat& motionFrame(const cv::Mat& frame);
+    void extractContours(cv::Mat& fg, cv::Point offset, std::vector<std::vector<cv::Point>>& contours, StageTimes& st);
+    void updateTracks(const cv::Mat& frame, double tsMs, EngineResult& res);
+    void checkDrift(const cv::Mat& frame, double tsMs, EngineResult& res);
+    bool foreground(const cv::Mat& frame, cv::Mat& fg, StageTimes& st);
+    int startTrack(const cv::Mat& frame, const cv::Rect2d& r, double tsMs, EngineResult& res, bool fresh = true);
+
+    EngineConfig m_cfg;
+    cv::Ptr<cv::BackgroundSubtractor> m_backSub; // MOG2 / KNN
+    FrameDiffDetector m_frameDiff;
+    cv::Mat m_kernel;
+    int m_blurSize = 5;
+    cv::Mat m_small;   // reused analysis-scale buffers
+    cv::Mat m_gray;
+    cv::Mat m_region;
+    MotionGrid m_grid;
+    ZoneMap m_zones;
+    cv::Rect m_motionRoi;
+    std::unique_ptr<PersonDetector> m_detector; // inline detection
+    AsyncDetector m_async;
+    AsyncDetector* m_det = &m_async; // m_async or a shared detector
+    int m_channel = 0;
+    cv::Mat m_detectBuf;
+    double m_lastHogFallback = -1e18;
+    DetectScheduler m_sched;
+    uint64_t m_staleDetections = 0;
+    TrackerFactory m_trackerFactory;
+    bool m_trackersCalibrated = false;
+    std::thread m_calibration;  // measures the backends off the frame path, joined by reset / shutdown
+    TrackManager m_tracks{ 1 };
+    size_t m_verifyCursor = 0;  // round robin over the tracks for re-verification
+    // lost tracks still searched for around their predicted position
+    struct LostTrack
+    {
+        int id = 0;
+        BoxPredictor motion;
+        int frames = 0;         // searched for so far
+    };
+    std::vector<LostTrack> m_lost;
+    size_t m_lostCursor = 0;
+    ReacquireStats m_reacq;
+    AppearanceGallery m_gallery{ 0 };
+    size_t m_appearanceCursor = 0; // one track's descriptor is refreshed per frame, round robin
+    cv::Mat m_fgBin;           // foreground mask as 0/1, shadows dropped
+    cv::Mat m_fgSum;           // integral image of m_fgBin (CV_32S, m_motionRoi): foreground pixel counts
+    bool m_fgSumValid = false;
+    int m_driftTick = 0;       // frames since the last drift check
+    uint64_t m_driftReleases = 0;
+    cv::Rect2d m_bbox;
+    bool m_autoMode = false;
+};
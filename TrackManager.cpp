@@ -0,0 +1,292 @@
+// TrackManager.cpp
+// Multi-target tracks with pooled updates, see TrackManager.h
+//
+
+#include "TrackManager.h"
+#include "SwcCommon.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+
+static const int kMaxLevel = 8;       // 1/16 of the frame size
+static const double kMinSide = 24.0;  // tracker box side (px) a level never goes below
+
+TrackManager::TrackManager(int threads)
+    : m_scaled(kMaxLevel + 1), m_built(kMaxLevel + 1, 0)
+{
+    setThreads(threads);
+}
+
+TrackManager::~TrackManager()
+{
+    setThreads(1);
+}
+
+void TrackManager::setThreads(int threads)
+{
+    if (threads <= 0) threads = max(1, (int)thread::hardware_concurrency());
+    if (threads == this->threads()) return;
+    if (!m_workers.empty()) 
+    {
+        {
+            lock_guard<mutex> lk(m_mtx);
+            m_stopping = true;
+        }
+        m_start.notify_all();
+        for (auto& t : m_workers) t.join();
+        m_workers.clear();
+        m_stopping = false;
+    }
+    for (int i = 1; i < threads; ++i) m_workers.emplace_back(&TrackManager::workerLoop, this);
+}
+
+double TrackManager::levelScale(int level)
+{
+    return pow(2.0, -level / 2.0);
+}
+
+// Coarsest level needed to bring box within the budget (each level halves the area)
+int TrackManager::chooseLevel(const cv::Rect2d& box) const
+{
+    if (m_budget <= 0.0) return 0;
+    int level = 0;
+    while (level < kMaxLevel) 
+    {
+        double s = levelScale(level);
+        if (box.area() * s * s <= m_budget) break;
+        if (min(box.width, box.height) * levelScale(level + 1) < kMinSide) break;
+        ++level;
+    }
+    return level;
+}
+
+// frame scaled to level, resized at most once per frame (m_built is cleared per frame)
+const cv::Mat& TrackManager::scaled(const cv::Mat& frame, int level)
+{
+    if (level <= 0) return frame;
+    if (!m_built[level]) 
+    {
+        double s = levelScale(level);
+        cv::resize(frame, m_scaled[level], cv::Size(), s, s, cv::INTER_AREA);
+        m_built[level] = 1;
+    }
+    return m_scaled[level];
+}
+
+double TrackManager::allowanceMs(size_t n) const
+{
+    if (m_timeBudget <= 0.0) return 0.0;
+    size_t rounds = (max<size_t>(1, n) + threads() - 1) / threads();
+    return m_timeBudget / rounds;
+}
+
+// New tracker for t.bbox on frame at level; t is left alone if that fails
+bool TrackManager::initTracker(Track& t, const cv::Mat& frame, int level, TrackerBackend backend)
+{
+    cv::Ptr<cv::Tracker> tracker = m_factory ? m_factory->create(backend) : cv::Ptr<cv::Tracker>();
+    if (!tracker) return false;
+    double s = levelScale(level);
+    const cv::Mat& f = scaled(frame, level);
+    cv::Rect r = cv::Rect(cv::Rect2d(t.bbox.x * s, t.bbox.y * s, t.bbox.width * s, t.bbox.height * s))
+        & cv::Rect(0, 0, f.cols, f.rows);
+    if (r.width <= 0 || r.height <= 0) return false;
+    try { tracker->init(f, r); }
+    catch (...) { return false; }
+    t.tracker = tracker;
+    t.level = level;
+    t.backend = backend;
+    t.updateMs = 0.0;
+    t.updates = 0;
+    return true;
+}
+
+int TrackManager::spawn(const cv::Mat& frame, const cv::Rect2d& box, double tsMs, bool fresh, int id)
+{
+    if (frame.empty()) return -1;
+    fill(m_built.begin(), m_built.end(), 0);
+    Track t;
+    t.bbox = clampRect(box, frame.cols, frame.rows);
+    t.startTs = tsMs;
+    t.fresh = fresh;
+    if (!m_factory) return -1;
+    TrackerBackend backend = m_factory->choose(allowanceMs(m_tracks.size() + 1));
+    if (!initTracker(t, frame, chooseLevel(t.bbox), backend)) return -1;
+    t.motion.init(t.bbox);
+    t.id = id > 0 ? id : m_nextId++;
+    m_nextId = max(m_nextId, t.id + 1);
+    m_tracks.push_back(move(t));
+    return m_tracks.back().id;
+}
+
+bool TrackManager::retire(int id, Track* out)
+{
+    auto it = find_if(m_tracks.begin(), m_tracks.end(), [id](const Track& t) { return t.id == id; });
+    if (it == m_tracks.end()) return false;
+    if (out) *out = move(*it);
+    m_tracks.erase(it);
+    return true;
+}
+
+void TrackManager::clear()
+{
+    m_tracks.clear();
+}
+
+const Track* TrackManager::match(const cv::Rect2d& box, double minIoU) const
+{
+    const Track* best = nullptr;
+    double bestIoU = minIoU;
+    for (const Track& t : m_tracks) 
+    {
+        double iou = rectIoU(box, t.bbox);
+        if (iou >= bestIoU) 
+        {
+            bestIoU = iou;
+            best = &t;
+        }
+    }
+    return best;
+}
+
+Track* TrackManager::find(int id)
+{
+    for (Track& t : m_tracks) 
+    {
+        if (t.id == id) return &t;
+    }
+    return nullptr;
+}
+
+vector<TrackBox> TrackManager::boxes() const
+{
+    vector<TrackBox> out;
+    out.reserve(m_tracks.size());
+    for (const Track& t : m_tracks) out.push_back({ t.id, t.bbox });
+    return out;
+}
+
+// Claim track indices until none are left. CSRT/KCF instances share no state, so distinct tracks
+// can update concurrently.
+void TrackManager::runJobs()
+{
+    const cv::Mat& frame = *m_frame;
+    for (size_t i = m_next++; i < m_tracks.size(); i = m_next++) 
+    {
+        Track& t = m_tracks[i];
+        if (t.fresh) continue; // started on this frame, already knows it
+        cv::Rect moved;
+        bool ok = false;
+        double t0 = nowMs();
+        try { ok = t.tracker->update(t.level > 0 ? m_scaled[t.level] : frame, moved); }
+        catch (...) { ok = false; }
+        double ms = nowMs() - t0;
+        t.updateMs = t.updates == 0 ? ms : t.updateMs + 0.2 * (ms - t.updateMs);
+        ++t.updates;
+        if (m_factory) m_factory->record(t.backend, ms);
+        if (ok) 
+        {
+            double inv = 1.0 / levelScale(t.level);
+            cv::Rect2d full(moved.x * inv, moved.y * inv, moved.width * inv, moved.height * inv);
+            t.bbox = clampRect(full, frame.cols, frame.rows);
+        }
+        m_ok[i] = ok ? 1 : 0;
+    }
+}
+
+void TrackManager::workerLoop()
+{
+    uint64_t seen = 0;
+    for (;;) 
+    {
+        {
+            unique_lock<mutex> lk(m_mtx);
+            m_start.wait(lk, [&] { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+            seen = m_generation;
+        }
+        runJobs();
+        {
+            lock_guard<mutex> lk(m_mtx);
+            --m_active;
+        }
+        m_done.notify_one();
+    }
+}
+
+void TrackManager::update(const cv::Mat& frame, vector<Track>& lost)
+{
+    lost.clear();
+    if (m_tracks.empty() || frame.empty()) return;
+
+    // every level in use is resized once, before the workers read it
+    fill(m_built.begin(), m_built.end(), 0);
+    for (const Track& t : m_tracks) 
+    {
+        if (!t.fresh) scaled(frame, t.level);
+    }
+
+    m_frame = &frame;
+    m_ok.assign(m_tracks.size(), 1);
+    m_next = 0;
+    size_t pending = count_if(m_tracks.begin(), m_tracks.end(), [](const Track& t) { return !t.fresh; });
+    if (m_workers.empty() || pending <= 1) 
+    {
+        runJobs();
+    }
+    else 
+    {
+        {
+            lock_guard<mutex> lk(m_mtx);
+            m_active = (int)m_workers.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+        runJobs();
+        unique_lock<mutex> lk(m_mtx);
+        m_done.wait(lk, [&] { return m_active == 0; });
+    }
+    m_frame = nullptr;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < m_tracks.size(); ++i) 
+    {
+        if (!m_ok[i]) 
+        {
+            lost.push_back(move(m_tracks[i]));
+            continue;
+        }
+        Track& t = m_tracks[i];
+        // target grew to twice the budget or shrank to a quarter of it: re-initialise at a new level
+        if (m_budget > 0.0 && !t.fresh) 
+        {
+            int want = chooseLevel(t.bbox);
+            double s = levelScale(t.level);
+            double px = t.bbox.area() * s * s;
+            bool tooBig = px > 2.0 * m_budget && want > t.level;
+            bool tooSmall = want < t.level && (px < m_budget / 4.0 || min(t.bbox.width, t.bbox.height) * s < kMinSide);
+            if ((tooBig || tooSmall) && initTracker(t, frame, want, t.backend)) ++m_rescales;
+        }
+        // over its share of the time budget for a few updates: a cheaper backend
+        double allowance = allowanceMs(m_tracks.size());
+        if (allowance > 0.0 && !t.fresh && t.updates >= 3 && t.updateMs > allowance) 
+        {
+            TrackerBackend from = t.backend;
+            double ms = t.updateMs;
+            TrackerBackend to = m_factory->downgrade(from, allowance);
+            if (to != from && initTracker(t, frame, t.level, to)) 
+            {
+                ++m_switches;
+                ostringstream msg;
+                msg << "Track " << t.id << ": " << trackerBackendName(from) << " " << fixed << setprecision(1) << ms
+                    << " ms over the " << allowance << " ms budget -> " << trackerBackendName(to);
+                swcLog(msg.str());
+            }
+        }
+        t.fresh = false;
+        if (kept != i) m_tracks[kept] = move(m_tracks[i]);
+        ++kept;
+    }
+    m_tracks.resize(kept);
+}
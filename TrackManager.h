@@ -0,0 +1,132 @@
+// TrackManager.h
+// Several simultaneous tracks, each with its own cv::Tracker and a stable id. The engine associates
+// new contour / detector candidates with the existing tracks by IoU (match) and spawns or retires
+// tracks; update() runs the per-track tracker updates in parallel on a small worker pool (the
+// calling thread takes a share too). Trackers come from a TrackerFactory (TrackerFactory.h).
+// Pixel budget: CSRT cost grows with the target's size in pixels, so each tracker runs on a copy of
+// the frame scaled by 2^(-level/2), the level chosen so the target stays within the budget. When the
+// target grows or shrinks past the budget by 2x the track is re-initialised at a new level. Boxes
+// are always kept in full-resolution frame coords.
+// Time budget: every update is timed. A track whose updates average more than its share of the
+// per-frame budget (budget / update rounds, rounds = tracks / threads) is re-initialised on the
+// cheaper backend the factory suggests, each switch is logged.
+//
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "TrackerFactory.h"
+#include "BoxPredictor.h"
+#include "AppearanceGallery.h"
+
+struct Track
+{
+    int id = 0;
+    cv::Ptr<cv::Tracker> tracker;
+    cv::Rect2d bbox;
+    double startTs = 0.0;  // frame time the track was started from
+    int verifyMisses = 0;  // detector re-verifications failed in a row
+    int level = 0;         // tracker runs on the frame scaled by TrackManager::levelScale(level)
+    TrackerBackend backend = TrackerBackend::CSRT;
+    double updateMs = 0.0; // running average of this track's updates
+    int updates = 0;       // since the last (re-)initialisation
+    bool fresh = false;    // initialised on the current frame, its next update is skipped
+    BoxPredictor motion;   // constant-velocity estimate of bbox, fed by the engine once per frame
+    AppearanceDescriptor appearance; // running colour descriptor for re-identification, refreshed by the engine
+    double motionShare = -1.0;   // running share of foreground pixels in bbox (engine drift check), -1 = not measured
+    double staticSinceMs = -1.0; // frame time the share fell under the drift threshold, -1 = moving
+};
+
+struct TrackBox
+{
+    int id = 0;
+    cv::Rect2d bbox;
+};
+
+class TrackManager
+{
+public:
+    // threads: update workers including the caller, 0 = one per core, 1 = inline
+    explicit TrackManager(int threads = 0);
+    ~TrackManager();
+    TrackManager(const TrackManager&) = delete;
+    TrackManager& operator=(const TrackManager&) = delete;
+
+    void setThreads(int threads);
+    int threads() const { return (int)m_workers.size() + 1; }
+    // Not owned, must outlive the manager (or be replaced before it goes)
+    void setFactory(TrackerFactory* factory) { m_factory = factory; }
+    // Per-frame wall time for all tracker updates in ms, <= 0 = no limit
+    void setTimeBudget(double ms) { m_timeBudget = ms; }
+    // Time one track may take per update under the budget with n tracks
+    double allowanceMs(size_t n) const;
+    // Target area in tracker pixels, <= 0 = trackers see the full-resolution frame
+    void setPixelBudget(double pixels) { m_budget = pixels; }
+    double pixelBudget() const { return m_budget; }
+    static double levelScale(int level);
+    // Level a new track around box would run at
+    int levelFor(const cv::Rect2d& box) const { return chooseLevel(box); }
+
+    // New track on frame around box (full-res coords), its id or -1 if the tracker could not be
+    // initialised. fresh = frame is the one the next update() runs on (that update skips it), false for
+    // earlier frames (detector results, UI selections). id > 0 brings
+    // back a retired track under its old id.
+    int spawn(const cv::Mat& frame, const cv::Rect2d& box, double tsMs, bool fresh = true, int id = 0);
+    // Id the next spawn will get; reserveId() burns it (a request was tagged with it, no track came of it)
+    int nextId() const { return m_nextId; }
+    void reserveId() { ++m_nextId; }
+    // Remove a track, moved to out if given
+    bool retire(int id, Track* out = nullptr);
+    void clear();
+
+    // Track overlapping box the most with IoU >= minIoU, nullptr if none
+    const Track* match(const cv::Rect2d& box, double minIoU) const;
+    Track* find(int id);
+    // Oldest track (the one a single-target consumer should follow), nullptr if none
+    const Track* primary() const { return m_tracks.empty() ? nullptr : &m_tracks.front(); }
+
+    // Update every track on frame in parallel; tracks whose update fails are removed and moved to
+    // lost. Boxes are clamped to the frame.
+    void update(const cv::Mat& frame, std::vector<Track>& lost);
+
+    bool empty() const { return m_tracks.empty(); }
+    size_t size() const { return m_tracks.size(); }
+    const std::vector<Track>& tracks() const { return m_tracks; }
+    std::vector<TrackBox> boxes() const;
+    uint64_t rescales() const { return m_rescales; }
+    uint64_t backendSwitches() const { return m_switches; }
+
+private:
+    void workerLoop();
+    void runJobs();
+    int chooseLevel(const cv::Rect2d& box) const;
+    const cv::Mat& scaled(const cv::Mat& frame, int level);
+    bool initTracker(Track& t, const cv::Mat& frame, int level, TrackerBackend backend);
+
+    std::vector<Track> m_tracks; // in spawn order
+    int m_nextId = 1;
+    TrackerFactory* m_factory = nullptr;
+    double m_budget = 0.0;
+    double m_timeBudget = 0.0;
+    uint64_t m_rescales = 0;
+    uint64_t m_switches = 0;
+    std::vector<cv::Mat> m_scaled;  // frame of the current update per level
+    std::vector<char> m_built;
+
+    // one update() in flight at a time: workers pull track indices until m_next runs past the end
+    std::vector<std::thread> m_workers;
+    std::mutex m_mtx;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    bool m_stopping = false;
+    uint64_t m_generation = 0;
+    int m_active = 0;            // workers still inside the current generation
+    std::atomic<size_t> m_next{ 0 };
+    const cv::Mat* m_frame = nullptr;
+    std::vector<char> m_ok;
+};
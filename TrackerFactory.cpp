@@ -0,0 +1,220 @@
+// TrackerFactory.cpp
+// Tracker backends and their measured cost, see TrackerFactory.h
+//
+
+#include "TrackerFactory.h"
+#include "SwcCommon.h"
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#if HAVE_OPENCV_TRACKING && __has_include(<opencv2/tracking/tracking_legacy.hpp>)
+#include <opencv2/tracking/tracking_legacy.hpp>
+#define HAVE_TRACKER_MOSSE 1
+#else
+#define HAVE_TRACKER_MOSSE 0
+#endif
+#define HAVE_TRACKER_NANO (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7))
+
+using namespace std;
+namespace fs = std::filesystem;
+
+const char* trackerBackendName(TrackerBackend b)
+{
+    switch (b) 
+    {
+    case TrackerBackend::CSRT: return "csrt";
+    case TrackerBackend::KCF: return "kcf";
+    case TrackerBackend::MOSSE: return "mosse";
+    case TrackerBackend::MIL: return "mil";
+    case TrackerBackend::Nano: return "nano";
+    default: return "?";
+    }
+}
+
+bool parseTrackerBackend(const string& s, TrackerBackend& b)
+{
+    for (int i = 0; i < (int)TrackerBackend::Count; ++i) 
+    {
+        if (s == trackerBackendName((TrackerBackend)i)) 
+        {
+            b = (TrackerBackend)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static cv::Ptr<cv::Tracker> createBackend(TrackerBackend b, const TrackerFactoryConfig& cfg)
+{
+    try 
+    {
+        switch (b) 
+        {
+#if HAVE_OPENCV_TRACKING
+        case TrackerBackend::CSRT: return cv::TrackerCSRT::create();
+        case TrackerBackend::KCF: return cv::TrackerKCF::create();
+#endif
+#if HAVE_TRACKER_MOSSE
+        case TrackerBackend::MOSSE: return cv::legacy::upgradeTrackingAPI(cv::legacy::TrackerMOSSE::create());
+#endif
+        case TrackerBackend::MIL: return cv::TrackerMIL::create();
+#if HAVE_TRACKER_NANO
+        case TrackerBackend::Nano: 
+        {
+            error_code ec;
+            if (!fs::exists(cfg.nanoBackbone, ec) || !fs::exists(cfg.nanoNeckhead, ec)) break;
+            cv::TrackerNano::Params p;
+            p.backbone = cfg.nanoBackbone;
+            p.neckhead = cfg.nanoNeckhead;
+            return cv::TrackerNano::create(p);
+        }
+#endif
+        default: break;
+        }
+    }
+    catch (...) {}
+    return cv::Ptr<cv::Tracker>();
+}
+
+TrackerFactory::TrackerFactory()
+{
+    configure(TrackerFactoryConfig());
+}
+
+void TrackerFactory::configure(const TrackerFactoryConfig& cfg)
+{
+    lock_guard<mutex> lk(m_mtx);
+    bool probe = !m_probed || cfg.nanoBackbone != m_cfg.nanoBackbone || cfg.nanoNeckhead != m_cfg.nanoNeckhead;
+    m_cfg = cfg;
+    if (!probe) return;
+    for (int i = 0; i < (int)TrackerBackend::Count; ++i) 
+    {
+        m_st[i] = TrackerBackendStats();
+        m_st[i].available = (bool)createBackend((TrackerBackend)i, m_cfg);
+    }
+    m_probed = true;
+}
+
+bool TrackerFactory::available(TrackerBackend b) const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_st[(int)b].available;
+}
+
+cv::Ptr<cv::Tracker> TrackerFactory::create(TrackerBackend b) const
+{
+    if (!available(b)) return cv::Ptr<cv::Tracker>();
+    return createBackend(b, m_cfg);
+}
+
+// Measured average, or a rough typical cost (ms for a ~100x200 px target) to rank unmeasured ones
+double TrackerFactory::expectedMs(TrackerBackend b) const
+{
+    const TrackerBackendStats& s = m_st[(int)b];
+    if (s.samples > 0) return s.avgUpdateMs;
+    switch (b) 
+    {
+    case TrackerBackend::MIL: return 30.0;
+    case TrackerBackend::CSRT: return 15.0;
+    case TrackerBackend::Nano: return 8.0;
+    case TrackerBackend::KCF: return 3.0;
+    default: return 0.5;
+    }
+}
+
+TrackerBackend TrackerFactory::choose(double allowanceMs) const
+{
+    lock_guard<mutex> lk(m_mtx);
+    TrackerBackend cheapest = TrackerBackend::Count;
+    for (TrackerBackend b : m_cfg.preference) 
+    {
+        const TrackerBackendStats& s = m_st[(int)b];
+        if (!s.available) continue;
+        if (allowanceMs <= 0.0 || s.samples == 0 || s.avgUpdateMs <= allowanceMs) return b;
+        if (cheapest == TrackerBackend::Count || expectedMs(b) < expectedMs(cheapest)) cheapest = b;
+    }
+    return cheapest == TrackerBackend::Count ? m_cfg.preference.front() : cheapest;
+}
+
+TrackerBackend TrackerFactory::downgrade(TrackerBackend b, double allowanceMs) const
+{
+    lock_guard<mutex> lk(m_mtx);
+    // meaningfully cheaper than b: the most preferred one that fits, else the cheapest
+    double current = expectedMs(b);
+    TrackerBackend cheapest = b;
+    for (TrackerBackend c : m_cfg.preference) 
+    {
+        if (c == b || !m_st[(int)c].available) continue;
+        double e = expectedMs(c);
+        if (e >= 0.8 * current) continue;
+        if (e <= allowanceMs) return c;
+        if (e < expectedMs(cheapest)) cheapest = c;
+    }
+    return cheapest;
+}
+
+void TrackerFactory::record(TrackerBackend b, double updateMs)
+{
+    lock_guard<mutex> lk(m_mtx);
+    TrackerBackendStats& s = m_st[(int)b];
+    s.avgUpdateMs = s.samples == 0 ? updateMs : s.avgUpdateMs + 0.1 * (updateMs - s.avgUpdateMs);
+    ++s.samples;
+}
+
+void TrackerFactory::calibrate(const cv::Mat& frame, const cv::Rect& box, int updates)
+{
+    ostringstream msg;
+    msg << "Tracker calibration (" << box.width << "x" << box.height << " target):";
+    for (int i = 0; i < (int)TrackerBackend::Count; ++i) 
+    {
+        TrackerBackend b = (TrackerBackend)i;
+        cv::Ptr<cv::Tracker> t = create(b);
+        if (!t) continue;
+        double initMs = 0.0, sum = 0.0;
+        int n = 0;
+        try 
+        {
+            double t0 = nowMs();
+            t->init(frame, box);
+            initMs = nowMs() - t0;
+            cv::Rect moved;
+            for (; n < updates; ++n) 
+            {
+                t0 = nowMs();
+                t->update(frame, moved);
+                sum += nowMs() - t0;
+            }
+        }
+        catch (...) {}
+        if (n == 0) continue;
+        {
+            lock_guard<mutex> lk(m_mtx);
+            TrackerBackendStats& s = m_st[i];
+            s.initMs = initMs;
+            // only a seed: updates of running trackers measured meanwhile are the better numbers
+            if (s.samples == 0) 
+            {
+                s.avgUpdateMs = sum / n;
+                s.samples = n;
+            }
+        }
+        msg << ' ' << trackerBackendName(b) << ' ' << fixed << setprecision(1) << sum / n << " ms";
+    }
+    swcLog(msg.str());
+}
+
+bool TrackerFactory::calibrated() const
+{
+    lock_guard<mutex> lk(m_mtx);
+    for (const TrackerBackendStats& s : m_st) 
+    {
+        if (s.available && s.samples > 0) return true;
+    }
+    return false;
+}
+
+TrackerBackendStats TrackerFactory::stats(TrackerBackend b) const
+{
+    lock_guard<mutex> lk(m_mtx);
+    return m_st[(int)b];
+}
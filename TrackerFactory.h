@@ -0,0 +1,88 @@
+// TrackerFactory.h
+// The tracker backends this OpenCV build offers (CSRT, KCF, MOSSE, MIL, Nano when its two ONNX
+// models are present) and what an update actually costs on this machine. Latencies come from
+// calibrate() (a few updates of each backend on a real frame) and from the running trackers
+// (record()). choose() gives a new track the most preferred backend that fits its time allowance;
+// downgrade() names a cheaper one for a track that runs over it.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#if __has_include(<opencv2/tracking.hpp>)
+#include <opencv2/tracking.hpp>
+#define HAVE_OPENCV_TRACKING 1
+#else
+#define HAVE_OPENCV_TRACKING 0
+#endif
+
+enum class TrackerBackend
+{
+    CSRT,   // contrib, most accurate of the classic ones, cost grows with the target size
+    KCF,    // contrib, a few ms
+    MOSSE,  // contrib legacy API, well under a ms, drifts on scale changes
+    MIL,    // main video module, slow
+    Nano,   // main video module (4.7+), small siamese network, needs the NanoTrack ONNX models
+    Count
+};
+
+const char* trackerBackendName(TrackerBackend b);
+bool parseTrackerBackend(const std::string& s, TrackerBackend& b);
+
+struct TrackerFactoryConfig
+{
+    // most wanted first, unavailable ones are skipped
+    std::vector<TrackerBackend> preference = { TrackerBackend::CSRT, TrackerBackend::Nano, TrackerBackend::KCF,
+                                               TrackerBackend::MIL, TrackerBackend::MOSSE };
+    std::string nanoBackbone = "nanotrack_backbone_sim.onnx";
+    std::string nanoNeckhead = "nanotrack_head_sim.onnx";
+};
+
+struct TrackerBackendStats
+{
+    bool available = false;
+    uint64_t samples = 0;     // updates measured (calibration seed, then running tracks)
+    double avgUpdateMs = 0.0; // running average, most recent updates weigh most
+    double initMs = 0.0;      // last calibration init
+};
+
+class TrackerFactory
+{
+public:
+    TrackerFactory();
+    // Probes which backends can be created. Only when the backend set or the Nano models change:
+    // probing creates every tracker (Nano loads its networks), measurements are kept otherwise.
+    void configure(const TrackerFactoryConfig& cfg);
+
+    bool available(TrackerBackend b) const;
+    // nullptr if the backend is not available
+    cv::Ptr<cv::Tracker> create(TrackerBackend b) const;
+
+    // Most preferred available backend whose measured update fits allowanceMs (unmeasured ones
+    // fit, <= 0 = no limit); the cheapest one if none fits
+    TrackerBackend choose(double allowanceMs) const;
+    // Cheaper backend for a track on b that takes longer than allowanceMs, b if there is none
+    TrackerBackend downgrade(TrackerBackend b, double allowanceMs) const;
+
+    // Measured update latency of a running tracker (thread-safe)
+    void record(TrackerBackend b, double updateMs);
+    // Init plus `updates` updates of every available backend on frame around box (slow, keep it
+    // off the frame path). Seeds the average of backends not measured yet, never replaces one.
+    void calibrate(const cv::Mat& frame, const cv::Rect& box, int updates = 5);
+    // Some available backend has been measured
+    bool calibrated() const;
+
+    TrackerBackendStats stats(TrackerBackend b) const;
+    const std::vector<TrackerBackend>& preference() const { return m_cfg.preference; }
+
+private:
+    double expectedMs(TrackerBackend b) const;
+
+    TrackerFactoryConfig m_cfg;
+    bool m_probed = false;
+    mutable std::mutex m_mtx;
+    TrackerBackendStats m_st[(int)TrackerBackend::Count];
+};